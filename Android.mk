@@ -1,3 +1,7 @@
+# This file is generated by androgenizer for:
+# [x] NDK
+# [ ] system
+
 LOCAL_PATH:=$(call my-dir)
 include $(CLEAR_VARS)
 
@@ -7,9 +11,21 @@ LOCAL_MODULE_TAGS:=optional
 
 LOCAL_SRC_FILES := \
 	main.c \
+	watch.c \
+	androgenizer.c \
 	options.c \
 	emit.c \
-	library.c
+	library.c \
+	hash.c \
+	profile.c \
+	scan.c \
+	cleanup.c \
+	symbols.c \
+	autolink.c \
+	merge.c \
+	flags.c \
+	cache.c \
+	sha256.c
 
 LOCAL_CFLAGS := \
 	-Wall \
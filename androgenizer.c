@@ -0,0 +1,127 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <stdlib.h>
+#include "androgenizer.h"
+#include "cleanup.h"
+#include "common.h"
+#include "emit.h"
+#include "hash.h"
+#include "options.h"
+
+struct androgenizer *androgenizer_new(void)
+{
+	return calloc(1, sizeof(struct androgenizer));
+}
+
+static void reset(struct androgenizer *a)
+{
+	int i;
+
+	for (i = 0; i < a->inputs; i++)
+		free(a->input[i]);
+	free(a->input);
+	a->input = NULL;
+	a->inputs = 0;
+
+	if (a->project)
+		cleanup_project(a->project);
+	a->project = NULL;
+	free(a->error);
+	a->error = NULL;
+	a->out.len = 0;
+	a->streamed_len = 0;
+	a->aggregate_depth = 0;
+	a->subdir = NULL;
+
+	/*
+	 * Files and directories may have come and gone since the last parse,
+	 * and the tables would only grow in a long running --watch.
+	 */
+	strmap_free(&a->dir_cache);
+	strmap_free(&a->file_cache);
+	strmap_free(&a->path_subst);
+	strmap_free(&a->strings);
+}
+
+void androgenizer_free(struct androgenizer *a)
+{
+	reset(a);
+	free(a->out.buf);
+	free(a);
+}
+
+void androgenizer_set_build(struct androgenizer *a,
+			    enum androgenizer_build build)
+{
+	a->build = build;
+}
+
+void androgenizer_set_output(struct androgenizer *a, FILE *f)
+{
+	a->out.file = f;
+}
+
+int androgenizer_parse(struct androgenizer *a, int count,
+		       const char *const *tokens)
+{
+	reset(a);
+
+	/* nothing writes to the tokens, options_parse just predates const */
+	a->project = options_parse(a, count, (char **)tokens);
+	a->streamed_len = a->out.len;
+	if (a->error)
+		return ANDROGENIZER_ERROR_ARGS;
+
+	return ANDROGENIZER_OK;
+}
+
+int androgenizer_parse_file(struct androgenizer *a, const char *path)
+{
+	reset(a);
+
+	a->project = options_parse_file(a, path);
+	a->streamed_len = a->out.len;
+	if (a->error)
+		return ANDROGENIZER_ERROR_ARGS;
+
+	return ANDROGENIZER_OK;
+}
+
+int androgenizer_inputs(struct androgenizer *a, const char *const **paths)
+{
+	*paths = (const char *const *)a->input;
+	return a->inputs;
+}
+
+int androgenizer_emit(struct androgenizer *a, const char **buf, size_t *len)
+{
+	if (!a->project)
+		return ANDROGENIZER_ERROR_NO_PROJECT;
+
+	a->out.len = a->streamed_len;
+	emit_file(&a->out, a->project);
+
+	*buf = a->out.buf ? a->out.buf : "";
+	*len = a->out.len;
+	return ANDROGENIZER_OK;
+}
+
+const char *androgenizer_error(struct androgenizer *a)
+{
+	return a->error;
+}
@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef __ANDROGENIZER_H__
+#define __ANDROGENIZER_H__
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * androgenizer as a library.  A context holds one parsed project and the
+ * Android.mk generated from it.  Contexts share nothing, so each thread
+ * can use its own.  Warnings still go to stderr.
+ */
+
+struct androgenizer;
+
+enum androgenizer_status {
+	ANDROGENIZER_OK = 0,
+	ANDROGENIZER_ERROR_ARGS,	/* see androgenizer_error() */
+	ANDROGENIZER_ERROR_NO_PROJECT,	/* nothing was parsed */
+};
+
+struct androgenizer *androgenizer_new(void);
+
+void androgenizer_free(struct androgenizer *a);
+
+enum androgenizer_build {
+	ANDROGENIZER_BUILD_GUESS = 0,	/* from ANDROID_BUILD_TOP */
+	ANDROGENIZER_BUILD_NDK,
+	ANDROGENIZER_BUILD_SYSTEM,
+};
+
+/*
+ * Generate for the NDK or for the system build from the next parse on,
+ * whatever ANDROID_BUILD_TOP says.  Each has its own root path to strip,
+ * NDK_ROOT or ANDROID_BUILD_TOP.
+ */
+void androgenizer_set_build(struct androgenizer *a,
+			    enum androgenizer_build build);
+
+/*
+ * Write the output straight to f instead of buffering it, or buffer
+ * again if f is NULL.  The buffer androgenizer_emit returns is then empty.
+ */
+void androgenizer_set_output(struct androgenizer *a, FILE *f);
+
+/*
+ * Parse count androgenizer arguments, exactly as they'd follow the
+ * program name on the command line.  Replaces any project parsed before,
+ * and forgets what it found on disk, so a parse never sees stale
+ * directories or headers.
+ */
+int androgenizer_parse(struct androgenizer *a, int count,
+		       const char *const *tokens);
+
+/*
+ * The same, with the arguments read from a file holding one per line,
+ * like the -:AGGREGATE files.
+ */
+int androgenizer_parse_file(struct androgenizer *a, const char *path);
+
+/*
+ * The files the last parse read its arguments from, including ones that
+ * couldn't be read.  Returns how many there are.
+ */
+int androgenizer_inputs(struct androgenizer *a, const char *const **paths);
+
+/*
+ * Generate the Android.mk for the parsed project.  *buf stays valid
+ * until the next call on a.  With -:STREAM, the modules were already
+ * generated by androgenizer_parse, and only the rest is added here.
+ * Without androgenizer_set_output they are still held in the buffer, so
+ * streaming only bounds memory when writing to a FILE.  Either way each
+ * distinct flag is kept until the next parse.
+ */
+int androgenizer_emit(struct androgenizer *a, const char **buf, size_t *len);
+
+/* the last parse error, or NULL */
+const char *androgenizer_error(struct androgenizer *a);
+
+#endif /* __ANDROGENIZER_H__ */
@@ -0,0 +1,312 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "autolink.h"
+#include "common.h"
+#include "hash.h"
+#include "profile.h"
+
+/*
+ * Internal helper libraries automake builds as .la end up as shared
+ * libraries of their own, loaded at startup by their one user.  When
+ * there's a single consumer that links, the helper is made a static
+ * library and linked into it instead: whole, for shared libraries, so
+ * they keep exporting what the helper did, or normally for executables.
+ *
+ * Only libraries marked with -:AUTO_LINK are converted: androgenizer
+ * can't see who else loads a library, eg. with dlopen.  They also have to
+ * be named lib<something>, that's all a -l<something> or
+ * lib<something>.la can refer to.  Helpers asked to
+ * stay shared one way or another (-:EXPORT_SYMBOLS, -:LINK_STARTUP,
+ * -:PGO copies, -:HEADERS) are left alone, and so are the ones linked
+ * for some architectures only, from a -:MERGE_ABI arch set.
+ */
+
+struct producer {
+	struct module *m;
+	struct module *consumer;
+	int consumers;
+	int per_arch;			/* linked by some ABIs only */
+	enum library_type ltype;	/* how the consumer links it */
+};
+
+struct auto_link {
+	struct strmap target;		/* "foo" for libfoo, to its producer */
+	struct strmap host;
+	struct producer *producer;
+	int producers;
+	struct module **module;		/* every module of the tree */
+	int modules;
+};
+
+static int is_host(enum module_type mtype)
+{
+	return mtype == MODULE_HOST_SHARED_LIBRARY ||
+	       mtype == MODULE_HOST_STATIC_LIBRARY ||
+	       mtype == MODULE_HOST_EXECUTABLE;
+}
+
+static int links(enum module_type mtype)
+{
+	return mtype != MODULE_STATIC_LIBRARY &&
+	       mtype != MODULE_HOST_STATIC_LIBRARY;
+}
+
+static int stays_shared(struct module *m)
+{
+	return !m->auto_link || m->export_only || m->link_startup ||
+	       m->pgo_generate || m->headers;
+}
+
+static void drop_flag(struct flag_array *arr, const char *flag)
+{
+	int i;
+
+	for (i = 0; i < arr->nr_flags; i++) {
+		if (strcmp(arr->flags[i].flag, flag) != 0)
+			continue;
+		memmove(&arr->flags[i], &arr->flags[i + 1],
+			(arr->nr_flags - i - 1) * sizeof(*arr->flags));
+		arr->nr_flags--;
+		return;
+	}
+}
+
+static void drop_ldflag(struct module *m, const char *flag)
+{
+	int i;
+
+	for (i = 0; i < m->libraries; i++) {
+		if (m->library[i].ltype != LIBRARY_FLAG ||
+		    strcmp(m->library[i].name, flag) != 0)
+			continue;
+		free(m->library[i].name);
+		memmove(&m->library[i], &m->library[i + 1],
+			(m->libraries - i - 1) * sizeof(*m->library));
+		m->libraries--;
+		return;
+	}
+}
+
+static void drop_passthrough(struct module *m, const char *str)
+{
+	int i;
+
+	for (i = 0; i < m->passthroughs; i++) {
+		if (strcmp(m->passthrough[i].name, str) != 0)
+			continue;
+		free(m->passthrough[i].name);
+		memmove(&m->passthrough[i], &m->passthrough[i + 1],
+			(m->passthroughs - i - 1) * sizeof(*m->passthrough));
+		m->passthroughs--;
+		return;
+	}
+}
+
+/*
+ * -:PROFILE settled the module's flags for a shared library, take back
+ * what a static one doesn't get, -flto first of all.
+ */
+static void make_static(struct module *m, enum build_type btype)
+{
+	const struct profile_directive *pd;
+	enum module_type shared = m->mtype;
+
+	m->mtype = is_host(shared) ?
+		   MODULE_HOST_STATIC_LIBRARY : MODULE_STATIC_LIBRARY;
+	if (m->profile == PROFILE_NONE)
+		return;
+
+	for (pd = profile_directives; pd->str; pd++) {
+		if (!profile_applies(pd, m->profile, shared, btype) ||
+		    profile_applies(pd, m->profile, m->mtype, btype))
+			continue;
+		switch (pd->kind) {
+		case PROFILE_CFLAG:
+			drop_flag(&m->c, pd->str);
+			break;
+		case PROFILE_LDFLAG:
+			drop_ldflag(m, pd->str);
+			break;
+		case PROFILE_PASSTHROUGH:
+			drop_passthrough(m, pd->str);
+			break;
+		}
+	}
+}
+
+static void collect(struct auto_link *al, struct project *p)
+{
+	int i;
+
+	for (i = 0; i < p->modules; i++) {
+		al->modules++;
+		al->module = realloc(al->module,
+				     al->modules * sizeof(struct module *));
+		al->module[al->modules - 1] = &p->module[i];
+	}
+	for (i = 0; i < p->subdirs; i++)
+		if (p->subdir[i].project)
+			collect(al, p->subdir[i].project);
+}
+
+static struct producer *producer_of(struct auto_link *al, struct module *m,
+				    struct library *l)
+{
+	struct strmap *map = is_host(m->mtype) ? &al->host : &al->target;
+	long i;
+
+	if (l->ltype != LIBRARY_EXTERNAL)
+		return NULL;
+
+	i = (long)strmap_get(map, l->name);
+	return i ? &al->producer[i - 1] : NULL;
+}
+
+static int has_library(struct module *m, const char *name)
+{
+	int i;
+
+	for (i = 0; i < m->libraries; i++)
+		if (m->library[i].ltype != LIBRARY_FLAG &&
+		    strcmp(m->library[i].name, name) == 0)
+			return 1;
+	return 0;
+}
+
+/*
+ * A static library's own libraries aren't linked for it, so whoever
+ * links it in needs them.  Returns whether anything was added.
+ */
+static int pull_libraries(struct module *consumer, struct module *helper)
+{
+	struct library *l;
+	int i, added = 0;
+
+	for (i = 0; i < helper->libraries; i++) {
+		l = &helper->library[i];
+		if (l->ltype == LIBRARY_FLAG || has_library(consumer, l->name))
+			continue;
+		if (strncmp(consumer->name, "lib", 3) == 0 &&
+		    strcmp(consumer->name + 3, l->name) == 0)
+			continue;
+		consumer->libraries++;
+		consumer->library = realloc(consumer->library,
+					    consumer->libraries *
+					    sizeof(struct library));
+		consumer->library[consumer->libraries - 1].name =
+			strdup(l->name);
+		consumer->library[consumer->libraries - 1].ltype = l->ltype;
+		added = 1;
+	}
+	return added;
+}
+
+void auto_link(struct project *p)
+{
+	struct auto_link al;
+	struct producer *pr;
+	struct module *m;
+	struct arch_set *a;
+	int i, j, k, changed;
+
+	memset(&al, 0, sizeof(al));
+	collect(&al, p);
+
+	for (i = 0; i < al.modules; i++) {
+		m = al.module[i];
+		if (m->mtype != MODULE_SHARED_LIBRARY &&
+		    m->mtype != MODULE_HOST_SHARED_LIBRARY)
+			continue;
+		if (strncmp(m->name, "lib", 3) != 0 || stays_shared(m))
+			continue;
+		al.producers++;
+		al.producer = realloc(al.producer,
+				      al.producers * sizeof(struct producer));
+		memset(&al.producer[al.producers - 1], 0, sizeof(struct producer));
+		al.producer[al.producers - 1].m = m;
+	}
+	/* indices, the array is done moving */
+	for (i = 0; i < al.producers; i++) {
+		m = al.producer[i].m;
+		strmap_put(is_host(m->mtype) ? &al.host : &al.target,
+			   m->name + 3, (void *)(long)(i + 1));
+	}
+
+	for (i = 0; i < al.modules; i++) {
+		m = al.module[i];
+		for (j = 0; j < m->libraries; j++) {
+			pr = producer_of(&al, m, &m->library[j]);
+			if (!pr || pr->m == m)
+				continue;
+			pr->consumers++;
+			pr->consumer = m;
+		}
+		for (k = 0; k < ARCHES; k++) {
+			a = &m->arch[k];
+			for (j = 0; j < a->libraries; j++) {
+				pr = producer_of(&al, m, &a->library[j]);
+				if (pr)
+					pr->per_arch = 1;
+			}
+		}
+	}
+
+	for (i = 0; i < al.producers; i++) {
+		pr = &al.producer[i];
+		if (pr->consumers != 1 || pr->per_arch ||
+		    !links(pr->consumer->mtype)) {
+			pr->consumers = 0;
+			continue;
+		}
+		pr->ltype = (pr->consumer->mtype == MODULE_EXECUTABLE ||
+			     pr->consumer->mtype == MODULE_HOST_EXECUTABLE) ?
+			    LIBRARY_STATIC : LIBRARY_WHOLE_STATIC;
+	}
+
+	for (i = 0; i < al.producers; i++) {
+		pr = &al.producer[i];
+		if (pr->consumers)
+			make_static(pr->m, p->btype);
+	}
+
+	/*
+	 * Helpers can use helpers, so until nothing new gets pulled in.
+	 * Within a static library, whole would copy the helper into it.
+	 */
+	do {
+		changed = 0;
+		for (i = 0; i < al.modules; i++) {
+			m = al.module[i];
+			for (j = 0; j < m->libraries; j++) {
+				pr = producer_of(&al, m, &m->library[j]);
+				if (!pr || !pr->consumers)
+					continue;
+				m->library[j].ltype = links(m->mtype) ?
+						      pr->ltype : LIBRARY_STATIC;
+				changed |= pull_libraries(m, pr->m);
+			}
+		}
+	} while (changed);
+
+	strmap_free(&al.target);
+	strmap_free(&al.host);
+	free(al.producer);
+	free(al.module);
+}
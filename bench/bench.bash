@@ -0,0 +1,158 @@
+#!/bin/bash
+#
+# Measures how long GNU make takes to parse what androgenizer generates,
+# and how much memory it needs, against the stub build system in stub/.
+#
+#   bench/bench.bash [<project dir>]
+#
+# <project dir> holds an Android.mk.args at its top and in each -:SUBDIR,
+# one androgenizer argument per line, as for -:AGGREGATE.  Without it a
+# synthetic project is generated.  Each variant of the output is parsed
+# RUNS times (default 5) and the fastest run is reported.
+#
+# Variants: every subdirectory -included from its own Android.mk, or all
+# of them -:AGGREGATEd into one, each with and without -:COMPACT_SOURCES.
+
+set -e
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+ANDROGENIZER=${ANDROGENIZER:-$BENCH/../androgenizer}
+RUSAGE=${RUSAGE:-$BENCH/rusage}
+MAKE=${MAKE:-make}
+RUNS=${RUNS:-5}
+ARGS=Android.mk.args
+
+SUBDIRS=${SUBDIRS:-40}
+MODULES=${MODULES:-5}
+SOURCES=${SOURCES:-30}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# a project shaped like an autotools one: helper libraries in
+# subdirectories, sources spread over a few directories each
+synthesize()
+{
+	local dir=$1 s m i
+
+	mkdir -p "$dir"
+	{
+		printf '%s\n' -:PROJECT bench -:SUBDIR
+		for s in $(seq $SUBDIRS); do
+			echo sub$s
+		done
+	} > "$dir/$ARGS"
+
+	for s in $(seq $SUBDIRS); do
+		mkdir -p "$dir/sub$s"
+		{
+			printf '%s\n' -:PROJECT bench -:REL_TOP .. \
+				-:ABS_TOP /src/bench
+			for m in $(seq $MODULES); do
+				printf '%s\n' -:SHARED libsub${s}_$m -:TAGS optional \
+					-:SOURCES
+				for i in $(seq $SOURCES); do
+					echo src$((i * 4 / (SOURCES + 1)))/file_${m}_$i.c
+				done
+				printf '%s\n' -:CFLAGS -DHAVE_CONFIG_H -I. -I.. \
+					-I../include -I../sub$s/private \
+					-DG_LOG_DOMAIN=\"sub$s\" -O2
+				printf '%s\n' -:LDFLAGS -lm -llog ../lib/libcommon.la
+			done
+		} > "$dir/sub$s/$ARGS"
+	done
+}
+
+# the arguments files of a tree, top first
+args_files()
+{
+	(cd "$1" && find . -name $ARGS | sort)
+}
+
+androgenize()
+{
+	local args=() line
+
+	while IFS= read -r line; do
+		[ -n "$line" ] && args+=("$line")
+	done < "$1"
+	[ -z "$2" ] || args+=("${@:2}")
+	"$ANDROGENIZER" "${args[@]}"
+}
+
+# a copy of the project with -:COMPACT_SOURCES after every module
+compact_copy()
+{
+	local from=$1 to=$2 f
+
+	for f in $(args_files "$from"); do
+		mkdir -p "$to/$(dirname "$f")"
+		awk '{ print } module { print "-:COMPACT_SOURCES"; module = 0 }
+		     /^-:(HOST_)?(SHARED|STATIC|EXECUTABLE)$/ { module = 1 }' \
+			"$from/$f" > "$to/$f"
+	done
+}
+
+separate()
+{
+	local dir=$1 f
+
+	for f in $(args_files "$dir"); do
+		(cd "$dir/$(dirname "$f")" && androgenize $ARGS > Android.mk)
+	done
+}
+
+aggregated()
+{
+	(cd "$1" && androgenize $ARGS -:AGGREGATE $ARGS > Android.mk)
+}
+
+measure()
+{
+	local name=$1 dir=$2 project best_ms= best_kb= ms kb run files bytes
+
+	project=$(sed -n '/^-:PROJECT$/{n;p;q}' "$dir/$ARGS")
+	files=$(find "$dir" -name Android.mk | wc -l)
+	bytes=$(find "$dir" -name Android.mk -exec cat {} + | wc -c)
+
+	for run in $(seq $RUNS); do
+		read ms kb < <("$RUSAGE" $MAKE -s -f "$BENCH/stub/main.mk" \
+			       TOP="$dir" PROJECT="$project")
+		if [ -z "$best_ms" ] || [ $ms -lt $best_ms ]; then
+			best_ms=$ms
+		fi
+		if [ -z "$best_kb" ] || [ $kb -lt $best_kb ]; then
+			best_kb=$kb
+		fi
+	done
+	printf '%-20s %9d %10d %9d %10d\n' $name $files $bytes $best_ms $best_kb
+}
+
+if [ -n "$1" ]; then
+	SRC=$(cd "$1" && pwd)
+else
+	SRC=$WORK/synthetic
+	synthesize "$SRC"
+fi
+
+compact_copy "$SRC" "$WORK/compact"
+for variant in separate aggregated; do
+	mkdir -p "$WORK/$variant"
+	cp -r "$SRC" "$WORK/$variant/plain"
+	cp -r "$WORK/compact" "$WORK/$variant/compact"
+done
+
+# androgenizer warnings aren't what's measured here
+exec 3>&2 2> "$WORK/warnings"
+separate "$WORK/separate/plain"
+separate "$WORK/separate/compact"
+aggregated "$WORK/aggregated/plain"
+aggregated "$WORK/aggregated/compact"
+exec 2>&3
+
+printf '%-20s %9s %10s %9s %10s\n' variant makefiles bytes parse_ms maxrss_kb
+for variant in separate aggregated; do
+	for sources in plain compact; do
+		measure $variant/$sources "$WORK/$variant/$sources"
+	done
+done
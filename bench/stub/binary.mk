@@ -0,0 +1,26 @@
+# Expands everything a module sets, and makes the object and link rules,
+# which is what the real BUILD_* makefiles spend most of their time on.
+
+ifeq ($(LOCAL_MODULE),)
+$(error $(LOCAL_PATH): LOCAL_MODULE is not set)
+endif
+ifneq ($(filter $(LOCAL_MODULE),$(ALL_MODULES)),)
+$(error $(LOCAL_PATH): module $(LOCAL_MODULE) defined twice)
+endif
+ALL_MODULES += $(LOCAL_MODULE)
+
+stub_obj := $(OUT)/obj/$(LOCAL_MODULE)
+stub_srcs := $(LOCAL_SRC_FILES) $(LOCAL_SRC_FILES_$(TARGET_ARCH)) \
+	$(patsubst $(LOCAL_PATH)/%,%,$(LOCAL_GENERATED_SOURCES))
+stub_srcs := $(patsubst %.neon,%,$(filter-out %.h,$(stub_srcs)))
+stub_objs := $(addprefix $(stub_obj)/,$(addsuffix .o,$(stub_srcs)))
+
+$(stub_obj)/module: PRIVATE_CFLAGS := $(LOCAL_CFLAGS) $(LOCAL_CFLAGS_$(TARGET_ARCH)) \
+	$(LOCAL_CPPFLAGS) $(addprefix -I,$(LOCAL_C_INCLUDES))
+$(stub_obj)/module: PRIVATE_LDFLAGS := $(LOCAL_LDFLAGS) $(LOCAL_LDLIBS)
+$(stub_obj)/module: PRIVATE_LIBS := $(LOCAL_SHARED_LIBRARIES) \
+	$(LOCAL_STATIC_LIBRARIES) $(LOCAL_WHOLE_STATIC_LIBRARIES)
+$(stub_obj)/module: $(stub_objs) $(LOCAL_ADDITIONAL_DEPENDENCIES)
+	@:
+$(stub_objs): $(stub_obj)/%.o: $(LOCAL_PATH)/%
+	@:
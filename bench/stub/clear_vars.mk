@@ -0,0 +1,4 @@
+# Every LOCAL_ variable but LOCAL_PATH is reset, like the real one does
+# with its list of a few hundred.
+
+$(foreach v,$(filter-out LOCAL_PATH,$(filter LOCAL_%,$(.VARIABLES))),$(eval $(v) :=))
@@ -0,0 +1,25 @@
+# The parts of build/core/definitions.mk and config.mk generated
+# Android.mk files rely on.
+
+my-dir = $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+
+OUT := out
+TARGET_ARCH := arm
+TARGET_ARCH_ABI := armeabi-v7a
+
+CLEAR_VARS := $(STUB)/clear_vars.mk
+BUILD_SHARED_LIBRARY := $(STUB)/binary.mk
+BUILD_STATIC_LIBRARY := $(STUB)/binary.mk
+BUILD_EXECUTABLE := $(STUB)/binary.mk
+BUILD_HOST_SHARED_LIBRARY := $(STUB)/binary.mk
+BUILD_HOST_STATIC_LIBRARY := $(STUB)/binary.mk
+BUILD_HOST_EXECUTABLE := $(STUB)/binary.mk
+
+local-intermediates-dir = $(OUT)/obj/$(LOCAL_MODULE_CLASS)/$(LOCAL_MODULE)_intermediates
+local-generated-sources-dir = $(OUT)/gen/$(LOCAL_MODULE_CLASS)/$(LOCAL_MODULE)_intermediates
+
+define transform-generated-source
+$(PRIVATE_CUSTOM_TOOL)
+endef
+
+ALL_MODULES :=
@@ -0,0 +1,11 @@
+# Parses an androgenizer generated tree the way the Android build would,
+# with stand-ins for the build system: make -f main.mk TOP=<dir> PROJECT=<name>
+
+.DEFAULT_GOAL := parsed
+parsed: ; @:
+
+STUB := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+include $(STUB)/definitions.mk
+
+$(PROJECT)_TOP := $(TOP)
+include $(TOP)/Android.mk
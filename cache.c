@@ -0,0 +1,301 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "common.h"
+#include "emit.h"
+#include "hash.h"
+#include "scan.h"
+#include "sha256.h"
+
+/*
+ * A module's key covers everything its output depends on that we can
+ * see: its type, name, flags, libraries and passthroughs, the contents
+ * of its sources and of every header they reach, the keys of the
+ * libraries of the tree it links and the toolchain id.  Headers that
+ * can't be found anywhere are taken to be the toolchain's.
+ *
+ * Modules with generated sources or computed #includes can't be keyed,
+ * and neither can anything that links them.
+ */
+
+struct entry {
+	struct module *m;
+	const char *dir;	/* of its -:AGGREGATE subdirectory, or NULL */
+	int state;		/* 0 not yet, 1 being keyed, 2 done */
+	char *key;		/* or NULL if it can't be cached */
+};
+
+struct cache {
+	struct project *top;
+	struct strmap target;	/* "foo" for libfoo, to its entry + 1 */
+	struct entry *entry;
+	int entries;
+};
+
+static void collect(struct cache *c, struct project *p)
+{
+	int i;
+
+	for (i = 0; i < p->modules; i++) {
+		c->entries++;
+		c->entry = realloc(c->entry, c->entries * sizeof(struct entry));
+		memset(&c->entry[c->entries - 1], 0, sizeof(struct entry));
+		c->entry[c->entries - 1].m = &p->module[i];
+		c->entry[c->entries - 1].dir = p->dir;
+	}
+	for (i = 0; i < p->subdirs; i++)
+		if (p->subdir[i].project)
+			collect(c, p->subdir[i].project);
+}
+
+static int cacheable(struct module *m)
+{
+	int i;
+
+	if (m->mtype != MODULE_SHARED_LIBRARY &&
+	    m->mtype != MODULE_STATIC_LIBRARY)
+		return 0;
+	/* a prebuilt can't generate anything or copy headers */
+	if (m->generators || (m->headers && !m->export_headers))
+		return 0;
+	for (i = 0; i < ARCHES; i++)
+		if (m->arch[i].libraries)
+			return 0;
+	return 1;
+}
+
+static void add_string(struct sha256 *s, const char *str)
+{
+	sha256_update(s, str, strlen(str) + 1);
+}
+
+static void add_int(struct sha256 *s, int n)
+{
+	char buf[16];
+
+	sprintf(buf, "%d", n);
+	add_string(s, buf);
+}
+
+static int add_file(struct sha256 *s, const char *dir, const char *name)
+{
+	char buf[65536];
+	char *path;
+	size_t n;
+	FILE *f;
+
+	if (dir && name[0] != '/') {
+		path = malloc(strlen(dir) + strlen(name) + 2);
+		sprintf(path, "%s/%s", dir, name);
+	} else {
+		path = strdup(name);
+	}
+	f = fopen(path, "rb");
+	free(path);
+	if (!f)
+		return 0;
+
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		sha256_update(s, buf, n);
+	n = ferror(f);
+	fclose(f);
+	return !n;
+}
+
+static int add_sources(struct sha256 *s, const char *dir,
+		       struct source *src, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		add_string(s, src[i].name);
+		if (!add_file(s, dir, src[i].name))
+			return 0;
+	}
+	return 1;
+}
+
+static void add_flags(struct sha256 *s, const char *what,
+		      struct flag_array *arr)
+{
+	int i;
+
+	add_string(s, what);
+	for (i = 0; i < arr->nr_flags; i++)
+		add_string(s, arr->flags[i].flag);
+}
+
+static const char *entry_key(struct cache *c, struct entry *e);
+
+/* what emit_libraries makes of l, after the -:LIBFILTERs */
+static enum library_type filtered(struct module *m, struct library *l)
+{
+	int i;
+
+	for (i = 0; i < m->libfilters; i++)
+		if (strcmp(l->name, m->libfilter[i].name) == 0)
+			return m->libfilter[i].ltype;
+	return l->ltype;
+}
+
+static int add_libraries(struct cache *c, struct sha256 *s, struct module *m)
+{
+	enum library_type ltype;
+	struct library *l;
+	const char *key;
+	long i, j;
+
+	for (i = 0; i < m->libraries; i++) {
+		l = &m->library[i];
+		ltype = filtered(m, l);
+		add_int(s, ltype);
+		add_string(s, l->name);
+		if (ltype == LIBRARY_NDK || ltype == LIBRARY_FLAG ||
+		    ltype == LIBRARY_UNSUPPORTED)
+			continue;
+
+		j = (long)strmap_get(&c->target, l->name);
+		if (!j || c->entry[j - 1].m == m)
+			continue;
+		key = entry_key(c, &c->entry[j - 1]);
+		if (!key)
+			return 0;
+		add_string(s, key);
+	}
+	return 1;
+}
+
+static int add_headers(struct cache *c, struct sha256 *s, struct entry *e)
+{
+	char **files;
+	int i, n, ok = 1;
+
+	n = scan_closure(&c->top->ctx->file_cache, e->m, e->dir, &files);
+	if (n < 0)
+		return 0;
+	for (i = 0; i < n; i++) {
+		if (ok)
+			ok = add_file(s, NULL, files[i]);
+		free(files[i]);
+	}
+	free(files);
+	return ok;
+}
+
+static char *compute_key(struct cache *c, struct entry *e)
+{
+	struct module *m = e->m;
+	struct sha256 s;
+	char hex[65];
+	int i;
+
+	sha256_init(&s);
+	add_string(&s, "androgenizer prebuilt cache 1");
+	add_string(&s, c->top->toolchain_id);
+	add_int(&s, c->top->btype);
+	add_int(&s, m->mtype);
+	add_string(&s, m->name);
+
+	add_flags(&s, "c", &m->c);
+	add_flags(&s, "cpp", &m->cpp);
+	add_flags(&s, "cxx", &m->cxx);
+	add_flags(&s, "include", &m->include);
+	for (i = 0; i < m->passthroughs; i++)
+		add_string(&s, m->passthrough[i].name);
+	add_int(&s, m->arm_neon);
+	add_int(&s, m->link_startup);
+	add_int(&s, m->export_only);
+	for (i = 0; i < m->export_symbols; i++)
+		add_string(&s, m->export_symbol[i]);
+	if (m->pgo_profile && !add_file(&s, e->dir, m->pgo_profile))
+		return NULL;
+
+	if (!add_libraries(c, &s, m))
+		return NULL;
+	if (!add_sources(&s, e->dir, m->source, m->sources))
+		return NULL;
+	for (i = 0; i < ARCHES; i++) {
+		add_string(&s, arch_name(i));
+		add_flags(&s, "c", &m->arch[i].c);
+		add_flags(&s, "cxx", &m->arch[i].cxx);
+		if (!add_sources(&s, e->dir, m->arch[i].source,
+				 m->arch[i].sources))
+			return NULL;
+	}
+	if (!add_headers(c, &s, e))
+		return NULL;
+
+	sha256_hex(&s, hex);
+	return strdup(hex);
+}
+
+/* NULL if e can't be cached, or is part of a loop of libraries */
+static const char *entry_key(struct cache *c, struct entry *e)
+{
+	if (e->state == 0) {
+		e->state = 1;
+		if (cacheable(e->m))
+			e->key = compute_key(c, e);
+		e->state = 2;
+	}
+	return e->key;
+}
+
+void prebuilt_cache(struct project *p)
+{
+	struct cache c;
+	struct entry *e;
+	struct stat st;
+	const char *key;
+	int i;
+
+	memset(&c, 0, sizeof(c));
+	c.top = p;
+	collect(&c, p);
+
+	/* indices, the array is done moving */
+	for (i = 0; i < c.entries; i++) {
+		e = &c.entry[i];
+		if ((e->m->mtype == MODULE_SHARED_LIBRARY ||
+		     e->m->mtype == MODULE_STATIC_LIBRARY) &&
+		    strncmp(e->m->name, "lib", 3) == 0)
+			strmap_put(&c.target, e->m->name + 3,
+				   (void *)(long)(i + 1));
+	}
+
+	for (i = 0; i < c.entries; i++) {
+		e = &c.entry[i];
+		key = entry_key(&c, e);
+		if (!key)
+			continue;
+		e->m->prebuilt = malloc(strlen(p->prebuilt_cache) +
+					strlen(key) + 2);
+		sprintf(e->m->prebuilt, "%s/%s", p->prebuilt_cache, key);
+		e->m->prebuilt_hit = stat(e->m->prebuilt, &st) == 0 &&
+				     S_ISDIR(st.st_mode);
+	}
+
+	for (i = 0; i < c.entries; i++)
+		free(c.entry[i].key);
+	free(c.entry);
+	strmap_free(&c.target);
+}
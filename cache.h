@@ -0,0 +1,29 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "common.h"
+
+/*
+ * -:PREBUILT_CACHE: key every target library of p, and of its aggregated
+ * -:SUBDIRs, by its inputs, and point it at its entry in the cache.
+ */
+void prebuilt_cache(struct project *p);
+
+#endif /* __CACHE_H__ */
@@ -0,0 +1,175 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <stdlib.h>
+#include "cleanup.h"
+#include "common.h"
+#include "hash.h"
+
+/* the flags themselves are interned, and freed with the context */
+static void cleanup_flag_array(struct flag_array *arr)
+{
+	free(arr->flags);
+}
+
+static void cleanup_header(struct header *h)
+{
+	free(h->name);
+}
+
+static void cleanup_sources(struct source *s)
+{
+	free(s->name);
+}
+
+static void cleanup_library(struct library *l)
+{
+	free(l->name);
+}
+
+static void cleanup_generator(struct generator *g)
+{
+	int i;
+
+	for (i = 0; i < g->inputs; i++)
+		free(g->input[i]);
+	free(g->input);
+	free(g->command);
+	free(g);
+}
+
+static void cleanup_passthrough(struct passthrough *p)
+{
+	free(p->name);
+}
+
+void cleanup_module(struct module *m)
+{
+	int i, j;
+
+	free(m->name);
+
+	if (m->header_target)
+		free(m->header_target);
+
+	if (m->headers) {
+		for (i = 0; i < m->headers; i++)
+			cleanup_header(&m->header[i]);
+		free(m->header);
+	}
+
+	if (m->sources) {
+		for (i = 0; i < m->sources; i++)
+			cleanup_sources(&m->source[i]);
+		free(m->source);
+	}
+
+	cleanup_flag_array(&m->c);
+	cleanup_flag_array(&m->cpp);
+	cleanup_flag_array(&m->cxx);
+	cleanup_flag_array(&m->include);
+	cleanup_flag_array(&m->export_include);
+
+	for (i = 0; i < ARCHES; i++) {
+		for (j = 0; j < m->arch[i].sources; j++)
+			cleanup_sources(&m->arch[i].source[j]);
+		free(m->arch[i].source);
+		cleanup_flag_array(&m->arch[i].c);
+		cleanup_flag_array(&m->arch[i].cxx);
+		for (j = 0; j < m->arch[i].libraries; j++)
+			cleanup_library(&m->arch[i].library[j]);
+		free(m->arch[i].library);
+		strset_free(&m->arch[i].source_set);
+	}
+
+	if (m->libraries) {
+		for (i = 0; i < m->libraries; i++)
+			cleanup_library(&m->library[i]);
+		free(m->library);
+	}
+
+	for (i = 0; i < m->unity_excludes; i++)
+		free(m->unity_exclude[i]);
+	free(m->unity_exclude);
+
+	if (m->generators) {
+		for (i = 0; i < m->generators; i++)
+			cleanup_generator(m->generator[i]);
+		free(m->generator);
+	}
+
+	if (m->libfilters) {
+		for (i = 0; i < m->libfilters; i++)
+			cleanup_library(&m->libfilter[i]);
+		free(m->libfilter);
+	}
+
+	if (m->passthroughs) {
+		for (i = 0; i < m->passthroughs; i++)
+			cleanup_passthrough(&m->passthrough[i]);
+		free(m->passthrough);
+	}
+
+	for (i = 0; i < m->export_symbols; i++)
+		free(m->export_symbol[i]);
+	free(m->export_symbol);
+	for (i = 0; i < m->export_headers_count; i++)
+		free(m->export_header[i]);
+	free(m->export_header);
+
+	free(m->pgo_suffix);
+	free(m->pgo_profile);
+	free(m->prebuilt);
+
+	strset_free(&m->source_set);
+	strset_free(&m->header_set);
+	strset_free(&m->library_set);
+}
+
+static void cleanup_subdir(struct subdir *s)
+{
+	free(s->name);
+	if (s->project)
+		cleanup_project(s->project);
+}
+
+void cleanup_project(struct project *p)
+{
+	int i;
+	if (p->modules) {
+		for (i = 0; i < p->modules; i++)
+			cleanup_module(&p->module[i]);
+		free(p->module);
+	}
+	if (p->subdirs) {
+		for (i = 0; i < p->subdirs; i++)
+			cleanup_subdir(&p->subdir[i]);
+		free(p->subdir);
+	}
+	free(p->name);
+	free(p->abs_top);
+	free(p->rel_top);
+	free(p->aggregate);
+	free(p->profiling_suffix);
+	free(p->prebuilt_cache);
+	free(p->toolchain_id);
+	free(p->dir);
+	for (i = 0; i < p->abis; i++)
+		free(p->abi[i].args);
+	free(p->abi);
+	free(p);
+}
@@ -19,6 +19,9 @@
 #ifndef __COMMON_H__
 #define __COMMON_H__
 
+#include <stddef.h>
+#include <stdio.h>
+
 enum module_type {
 	MODULE_SHARED_LIBRARY,
 	MODULE_STATIC_LIBRARY,
@@ -47,6 +50,14 @@ enum build_type {
 	BUILD_EXTERNAL
 };
 
+enum arch {
+	ARCH_ARM,
+	ARCH_ARM64,
+	ARCH_X86,
+	ARCH_X86_64,
+	ARCHES
+};
+
 enum tags {
 	TAG_NONE = 0,
 	TAG_USER = 1,
@@ -56,14 +67,36 @@ enum tags {
         TAG_DEBUG = 16
 };
 
+enum profile {
+	PROFILE_NONE,
+	PROFILE_RELEASE,
+	PROFILE_SIZE,
+	PROFILE_DEBUG
+};
+
+enum link_startup {
+	LINK_DEFAULT,
+	LINK_NOW,
+	LINK_LAZY
+};
+
+enum scan_mode {
+	SCAN_NONE,
+	SCAN_REORDER,
+	SCAN_DROP
+};
+
 enum flag_action {
 	FLAG_USE,
 	FLAG_SKIP,
 	FLAG_SKIP_WITH_ARG
 };
 
+/* a rule producing one source of the module from its inputs */
 struct generator {
-
+	char **input;
+	int inputs;
+	char *command; /* may use $< $^ and $@ */
 };
 
 struct passthrough {
@@ -75,8 +108,10 @@ struct source {
 	struct generator *gen;
 };
 
+/* both strings are interned in the context, see strmap_intern() */
 struct flag {
-	char *flag;
+	const char *flag;
+	const char *path; /* -I directory as given on the command line, or NULL */
 };
 
 struct flag_array {
@@ -84,19 +119,56 @@ struct flag_array {
 	int nr_flags;
 };
 
+/* open addressing hash set of borrowed strings, see hash.c */
+struct strset {
+	const char **slot;
+	int size;
+	int count;
+};
+
+/* the same, mapping owned string keys to borrowed values */
+struct strmap_entry {
+	char *key;
+	void *value;
+};
+
+struct strmap {
+	struct strmap_entry *slot;
+	int size;
+	int count;
+};
+
 struct library {
 	char *name;
 	enum library_type ltype;
 };
 
+/* sources, flags and libraries only built for one architecture */
+struct arch_set {
+	struct source *source;
+	int sources;
+	struct flag_array c;
+	struct flag_array cxx;
+	struct library *library;
+	int libraries;
+	struct strset source_set;
+};
+
 struct subdir {
 	char *name;
+	struct project *project; /* parsed arguments, when aggregating */
 };
 
 struct header {
 	char *name;
 };
 
+/* one ABI's configure results, for -:MERGE_ABI */
+struct abi {
+	enum arch arch;
+	char *args;	/* arguments file */
+};
+
 struct module {
 	char *name; /* local_module; */
 	enum module_type mtype;
@@ -110,6 +182,11 @@ struct module {
 	struct flag_array cpp;
 	struct flag_array cxx;
 	struct flag_array include;
+	struct flag_array export_include; /* -:EXPORT_HEADERS directories */
+
+	struct arch_set arch[ARCHES];
+	int arm_neon;
+	int only_arches;	/* bitmask of enum arch, 0 for all of them */
 
 	struct library *library;
 	int libraries;
@@ -117,7 +194,36 @@ struct module {
 	int libfilters;
 	struct passthrough *passthrough;
 	int passthroughs;
+	struct generator **generator;
+	int generators;
 	int tags;
+	int compact_sources;
+	int export_headers;
+	int export_only;	/* -:EXPORT_SYMBOLS */
+	enum link_startup link_startup;
+	int pack_relocations;	/* -:LINK_STARTUP ... pack */
+	int auto_link;		/* may be linked into its one user */
+	char **export_symbol;	/* allowlist, then sorted with the scanned */
+	int export_symbols;
+	char **export_header;	/* -:HEADERS as paths for make rules */
+	int export_headers_count;
+	int unity;		/* sources per -:UNITY batch, 0 for none */
+	char **unity_exclude;
+	int unity_excludes;
+	enum profile profile;
+
+	int pgo_generate;
+	int pgo_use;
+	char *pgo_suffix;	/* instrumented copy name suffix, or NULL */
+	char *pgo_profile;	/* .profdata for -fprofile-use, or NULL */
+
+	char *prebuilt;		/* -:PREBUILT_CACHE entry directory, or NULL */
+	int prebuilt_hit;	/* which was there when we looked */
+
+	/* for dropping duplicate sources, headers and libraries */
+	struct strset source_set;
+	struct strset header_set;
+	struct strset library_set;
 };
 
 struct project {
@@ -131,6 +237,54 @@ struct project {
 	char *abs_top;
 	char *rel_top;
 	const char *root_path;
+	struct androgenizer *ctx;
+	char *aggregate; /* per-directory arguments file, or NULL */
+	struct abi *abi;
+	int abis;
+	int warn_duplicates;
+	int relocatable;
+	int prune_includes;
+	int canonical_flags;
+	enum scan_mode scan_includes;
+	enum profile profile; /* default for new modules */
+	int stream;
+	int auto_link;
+	char *profiling_suffix;	/* -:PROFILING_VARIANT, or NULL */
+	int profiling_instrument;
+	char *prebuilt_cache;	/* -:PREBUILT_CACHE directory, or NULL */
+	char *toolchain_id;
+	char *dir;	/* of an -:AGGREGATE subdirectory, NULL at the top */
+	int streamed; /* modules already written out by -:STREAM */
+};
+
+/* a growing buffer the Android.mk is written to, or a file if set */
+struct output {
+	char *buf;
+	size_t len;
+	size_t size;
+	FILE *file;
+};
+
+/*
+ * Everything a parse needs besides its arguments, so that separate
+ * contexts can be used from separate threads.  See androgenizer.h.
+ */
+struct androgenizer {
+	const char *cflag_space;	/* for parsing -I<space>path etc. */
+	const char *pgo_keyword;	/* for -:PGO generate|use <arg> */
+	int build;			/* enum androgenizer_build */
+	int aggregate_depth;
+	const char *subdir;		/* the next -:PROJECT's directory */
+	struct strmap dir_cache;	/* shared by every module parsed */
+	struct strmap file_cache;
+	struct strmap strings;		/* flags of every module, interned */
+	struct strmap path_subst;	/* flag_path_subst() results */
+	char *error;
+	char **input;			/* files arguments were read from */
+	int inputs;
+	struct project *project;
+	struct output out;
+	size_t streamed_len;	/* of out, written by -:STREAM during parse */
 };
 
 #endif /*__COMMON_H__*/
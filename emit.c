@@ -16,12 +16,51 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 #include <assert.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "common.h"
+#include "emit.h"
 
-void emit_libraries(struct library *l, int count, enum build_type bt,
-                    struct library *filt, int fcount)
+static void out_printf(struct output *o, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+static void out_printf(struct output *o, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	if (o->file) {
+		va_start(ap, fmt);
+		vfprintf(o->file, fmt, ap);
+		va_end(ap);
+		return;
+	}
+
+	va_start(ap, fmt);
+	len = vsnprintf(o->buf + o->len, o->size - o->len, fmt, ap);
+	va_end(ap);
+
+	if (o->len + len >= o->size) {
+		while (o->len + len >= o->size)
+			o->size = o->size ? o->size * 2 : 4096;
+		o->buf = realloc(o->buf, o->size);
+
+		va_start(ap, fmt);
+		vsnprintf(o->buf + o->len, o->size - o->len, fmt, ap);
+		va_end(ap);
+	}
+	o->len += len;
+}
+
+/*
+ * Each variable is written as LOCAL_<name><suffix><op>, suffix being
+ * empty or _<arch>, and op := or +=.
+ */
+static void emit_libraries(struct output *o, struct library *l, int count,
+                           enum build_type bt, struct library *filt,
+                           int fcount, const char *suffix, const char *op)
 {
 	int i, j, first;
 /*libfilter pass.  this is the king of the kludges, but I haven't
@@ -40,50 +79,50 @@ void emit_libraries(struct library *l, int count, enum build_type bt,
 			    (l[i].ltype == LIBRARY_UNSUPPORTED)) {
 				if (first) {
 					first = 0;
-					printf("LOCAL_LDLIBS:=\\\n");
-				} else printf(" \\\n");
-				printf("\t-l%s", l[i].name);
+					out_printf(o, "LOCAL_LDLIBS%s%s\\\n", suffix, op);
+				} else out_printf(o, " \\\n");
+				out_printf(o, "\t-l%s", l[i].name);
 			}
 		}
 		if (!first)
-			printf("\n");
+			out_printf(o, "\n");
 		first = 1;
 		for (i = 0; i < count; i++) {
 			if (l[i].ltype == LIBRARY_EXTERNAL) {
 				if (first) {
 					first = 0;
-					printf("LOCAL_SHARED_LIBRARIES:=\\\n");
-				} else printf(" \\\n");
-				printf("\tlib%s", l[i].name);
+					out_printf(o, "LOCAL_SHARED_LIBRARIES%s%s\\\n", suffix, op);
+				} else out_printf(o, " \\\n");
+				out_printf(o, "\tlib%s", l[i].name);
 			}
 		}
 		if (!first)
-			printf("\n\n");
+			out_printf(o, "\n\n");
 		first = 1;
 		for (i = 0; i < count; i++) {
 			if (l[i].ltype == LIBRARY_STATIC) {
 				if (first) {
 					first = 0;
-					printf("LOCAL_STATIC_LIBRARIES:=\\\n");
-				} else printf(" \\\n");
-				printf("\tlib%s", l[i].name);
+					out_printf(o, "LOCAL_STATIC_LIBRARIES%s%s\\\n", suffix, op);
+				} else out_printf(o, " \\\n");
+				out_printf(o, "\tlib%s", l[i].name);
 			}
 		}
 		if (!first)
-			printf("\n\n");
+			out_printf(o, "\n\n");
 
 		first = 1;
 		for (i = 0; i < count; i++) {
 			if (l[i].ltype == LIBRARY_WHOLE_STATIC) {
 				if (first) {
 					first = 0;
-					printf("LOCAL_WHOLE_STATIC_LIBRARIES:=\\\n");
-				} else printf(" \\\n");
-				printf("\tlib%s", l[i].name);
+					out_printf(o, "LOCAL_WHOLE_STATIC_LIBRARIES%s%s\\\n", suffix, op);
+				} else out_printf(o, " \\\n");
+				out_printf(o, "\tlib%s", l[i].name);
 			}
 		}
 		if (!first) {
-			printf("\n\n");
+			out_printf(o, "\n\n");
 		}
 	} else { /* bt == BUILD_EXTERNAL */
 		first = 1;
@@ -93,39 +132,39 @@ void emit_libraries(struct library *l, int count, enum build_type bt,
                             (l[i].ltype != LIBRARY_WHOLE_STATIC)) {
 				if (first) {
 					first = 0;
-					printf("LOCAL_SHARED_LIBRARIES:=\\\n");
-				} else printf(" \\\n");
-				printf("\tlib%s", l[i].name);
+					out_printf(o, "LOCAL_SHARED_LIBRARIES%s%s\\\n", suffix, op);
+				} else out_printf(o, " \\\n");
+				out_printf(o, "\tlib%s", l[i].name);
 			}
 		}
 		if (!first)
-			printf("\n\n");
+			out_printf(o, "\n\n");
 
 		first = 1;
 		for (i = 0; i < count; i++) {
 			if ((l[i].ltype == LIBRARY_STATIC)) {
 				if (first) {
 					first = 0;
-					printf("LOCAL_STATIC_LIBRARIES:=\\\n");
-				} else printf(" \\\n");
-				printf("\tlib%s", l[i].name);
+					out_printf(o, "LOCAL_STATIC_LIBRARIES%s%s\\\n", suffix, op);
+				} else out_printf(o, " \\\n");
+				out_printf(o, "\tlib%s", l[i].name);
 			}
 		}
 		if (!first)
-			printf("\n\n");
+			out_printf(o, "\n\n");
 
 		first = 1;
 		for (i = 0; i < count; i++) {
 			if ((l[i].ltype == LIBRARY_WHOLE_STATIC)) {
 				if (first) {
 					first = 0;
-					printf("LOCAL_WHOLE_STATIC_LIBRARIES:=\\\n");
-				} else printf(" \\\n");
-				printf("\tlib%s", l[i].name);
+					out_printf(o, "LOCAL_WHOLE_STATIC_LIBRARIES%s%s\\\n", suffix, op);
+				} else out_printf(o, " \\\n");
+				out_printf(o, "\tlib%s", l[i].name);
 			}
 		}
 		if (!first)
-			printf("\n\n");
+			out_printf(o, "\n\n");
 	}
 
 	first = 1;
@@ -133,136 +172,586 @@ void emit_libraries(struct library *l, int count, enum build_type bt,
 		if (l[i].ltype == LIBRARY_FLAG) {
 			if (first) {
 				first = 0;
-				printf("LOCAL_LDFLAGS:=\\\n");
-			} else printf("\\\n");
-			printf("\t%s", l[i].name);
+				out_printf(o, "LOCAL_LDFLAGS%s%s\\\n", suffix, op);
+			} else out_printf(o, "\\\n");
+			out_printf(o, "\t%s", l[i].name);
 		}
 	}
 	if (!first)
-		printf("\n\n");
+		out_printf(o, "\n\n");
 }
 
-static void emit_flag_array(const char *assignment, struct flag_array *arr)
+static void emit_flag_array(struct output *o, const char *assignment,
+			    struct flag_array *arr)
 {
 	int i;
 
 	if (!arr->flags || arr->nr_flags == 0)
 		return;
 
-	printf("%s", assignment);
+	out_printf(o, "%s", assignment);
 	for (i = 0; i < arr->nr_flags; i++)
-		printf(" \\\n\t%s",  arr->flags[i].flag);
-	printf("\n\n");
+		out_printf(o, " \\\n\t%s",  arr->flags[i].flag);
+	out_printf(o, "\n\n");
 }
 
-int emit_file(struct project *p)
+/* length of the directory part of a source, including the trailing slash */
+static int source_dir_len(const char *name)
 {
-	int i, j;
+	const char *slash = strrchr(name, '/');
 
-	printf("# This file is generated by androgenizer for:\n");
-	printf("# [%s] NDK\n", (p->btype == BUILD_NDK) ? "x" : " ");
-	printf("# [%s] system\n\n", (p->btype == BUILD_EXTERNAL) ? "x" : " ");
+	if (!slash || strpbrk(name, ", $"))
+		return 0;
 
-	printf("LOCAL_PATH:=$(call my-dir)\n");
+	return slash - name + 1;
+}
 
-	if (p->stype == SCRIPT_TOP)
-		printf("%s_TOP := $(LOCAL_PATH)\n", p->name);
+/*
+ * Consecutive sources in the same directory are written as
+ * $(addprefix dir/,a.c b.c ...), which expands to exactly the same
+ * ordered list without repeating the directory on every line.
+ */
+static void emit_sources_compact(struct output *o, const char *assignment,
+				 struct source *s, int count)
+{
+	int i, j, len;
+
+	out_printf(o, "%s", assignment);
+	for (i = 0; i < count; i = j) {
+		len = source_dir_len(s[i].name);
+		for (j = i + 1; len && j < count; j++)
+			if (source_dir_len(s[j].name) != len ||
+			    strncmp(s[i].name, s[j].name, len) != 0)
+				break;
+		if (j == i + 1) {
+			out_printf(o, " \\\n\t%s", s[i].name);
+			continue;
+		}
 
-	for (i = 0; i < p->modules; i++) {
-		struct module *m = &p->module[i];
-		printf("include $(CLEAR_VARS)\n\n");
+		out_printf(o, " \\\n\t$(addprefix %.*s,", len, s[i].name);
+		for (; i < j; i++)
+			out_printf(o, "%s%s", s[i].name + len, i == j - 1 ? ")" : " ");
+	}
+	out_printf(o, "\n\n");
+}
 
-		printf("LOCAL_MODULE:=%s\n\n", m->name);
-/* no tags == no build for the external dir... */
-		if (m->tags) {
-			printf("LOCAL_MODULE_TAGS:=");
-			if (m->tags & TAG_USER)
-				printf("user ");
-			if (m->tags & TAG_ENG)
-				printf("eng ");
-			if (m->tags & TAG_TESTS)
-				printf("tests ");
-			if (m->tags & TAG_OPTIONAL)
-				printf("optional ");
-			if (m->tags & TAG_DEBUG)
-				printf("debug ");
-			printf("\n\n");
+static void emit_sources(struct output *o, const char *assignment,
+			 struct source *s, int count, int compact)
+{
+	int i;
+
+	if (compact) {
+		emit_sources_compact(o, assignment, s, count);
+		return;
+	}
+
+	out_printf(o, "%s \\\n", assignment);
+	for (i = 0; i < count - 1; i++)
+		out_printf(o, "\t%s \\\n", s[i].name);
+	out_printf(o, "\t%s\n\n", s[i].name);
+}
+
+static const char *arch_names[] = {
+	[ARCH_ARM] = "arm",
+	[ARCH_ARM64] = "arm64",
+	[ARCH_X86] = "x86",
+	[ARCH_X86_64] = "x86_64",
+};
+
+const char *arch_name(enum arch arch)
+{
+	return arch_names[arch];
+}
+
+/*
+ * The system build has LOCAL_SRC_FILES_<arch>, LOCAL_CFLAGS_<arch> and
+ * so on, ndk-build doesn't, so there we test TARGET_ARCH instead.
+ */
+static void emit_arches(struct output *o, struct project *p, struct module *m)
+{
+	char assignment[64], suffix[16];
+	struct arch_set *a;
+	int i;
+
+	if (m->arm_neon)
+		out_printf(o, "LOCAL_ARM_NEON := true\n\n");
+
+	for (i = 0; i < ARCHES; i++) {
+		a = &m->arch[i];
+		if (!a->sources && !a->c.nr_flags && !a->cxx.nr_flags &&
+		    !a->libraries)
+			continue;
+
+		if (p->btype == BUILD_NDK) {
+			out_printf(o, "ifeq ($(TARGET_ARCH),%s)\n", arch_names[i]);
+			if (a->sources)
+				emit_sources(o, "LOCAL_SRC_FILES +=", a->source,
+					     a->sources, m->compact_sources);
+			emit_flag_array(o, "LOCAL_CFLAGS +=", &a->c);
+			emit_flag_array(o, "LOCAL_CPPFLAGS +=", &a->cxx);
+			emit_libraries(o, a->library, a->libraries, p->btype,
+				       m->libfilter, m->libfilters, "", "+=");
+			out_printf(o, "endif\n\n");
+			continue;
+		}
+
+		if (a->sources) {
+			sprintf(assignment, "LOCAL_SRC_FILES_%s :=", arch_names[i]);
+			emit_sources(o, assignment, a->source, a->sources,
+				     m->compact_sources);
 		}
+		sprintf(assignment, "LOCAL_CFLAGS_%s :=", arch_names[i]);
+		emit_flag_array(o, assignment, &a->c);
+		sprintf(assignment, "LOCAL_CPPFLAGS_%s :=", arch_names[i]);
+		emit_flag_array(o, assignment, &a->cxx);
+		sprintf(suffix, "_%s", arch_names[i]);
+		emit_libraries(o, a->library, a->libraries, p->btype,
+			       m->libfilter, m->libfilters, suffix, ":=");
+	}
+}
+
+/* the names of the arches in mask, for make */
+static void emit_arch_list(struct output *o, int mask)
+{
+	const char *sep = "";
+	int i;
+
+	for (i = 0; i < ARCHES; i++) {
+		if (!(mask & (1 << i)))
+			continue;
+		out_printf(o, "%s%s", sep, arch_names[i]);
+		sep = " ";
+	}
+}
+
+/* generated sources are emitted as rules by emit_generated() instead */
+static void emit_plain_sources(struct output *o, struct module *m)
+{
+	struct source *plain = malloc(m->sources * sizeof(struct source));
+	int i, count = 0;
+
+	for (i = 0; i < m->sources; i++)
+		if (!m->source[i].gen)
+			plain[count++] = m->source[i];
+
+	if (count)
+		emit_sources(o, "LOCAL_SRC_FILES :=", plain, count,
+			     m->compact_sources);
+	free(plain);
+}
+
+static const char *module_class(enum module_type mtype)
+{
+	switch (mtype) {
+	case MODULE_SHARED_LIBRARY:
+	case MODULE_HOST_SHARED_LIBRARY:
+		return "SHARED_LIBRARIES";
+	case MODULE_STATIC_LIBRARY:
+	case MODULE_HOST_STATIC_LIBRARY:
+		return "STATIC_LIBRARIES";
+	default:
+		return "EXECUTABLES";
+	}
+}
+
+static int is_host_module(enum module_type mtype)
+{
+	return mtype == MODULE_HOST_SHARED_LIBRARY ||
+	       mtype == MODULE_HOST_STATIC_LIBRARY ||
+	       mtype == MODULE_HOST_EXECUTABLE;
+}
 
-		if (m->sources) {
-/* should do two passes?  one for LOCAL_SRC_FILES, one for generated */
-			printf("LOCAL_SRC_FILES := \\\n");
-			for (j = 0; j < m->sources - 1; j++)
-				printf("\t%s \\\n", m->source[j].name);
-			printf("\t%s\n\n", m->source[j].name);
+static int is_header(const char *name)
+{
+	int len = strlen(name);
+
+	return len > 2 && strcmp(name + len - 2, ".h") == 0;
+}
+
+/*
+ * The system build generates into the module's intermediates with
+ * transform-generated-source, and only then compiles the objects.
+ * ndk-build has no LOCAL_GENERATED_SOURCES, so there the file is
+ * generated next to the sources and listed in LOCAL_SRC_FILES, and
+ * generated headers are order-only prerequisites of every source.
+ */
+static void emit_generated(struct output *o, struct project *p,
+			   struct module *m)
+{
+	struct generator *g;
+	int i, j, first;
+
+	if (!m->generators)
+		return;
+
+	if (p->btype == BUILD_EXTERNAL) {
+		out_printf(o, "LOCAL_MODULE_CLASS := %s\n", module_class(m->mtype));
+		if (is_host_module(m->mtype))
+			out_printf(o, "LOCAL_IS_HOST_MODULE := true\n");
+		out_printf(o, "intermediates := $(call local-generated-sources-dir)\n\n");
+	}
+
+	for (i = 0; i < m->sources; i++) {
+		g = m->source[i].gen;
+		if (!g)
+			continue;
+
+		if (p->btype == BUILD_EXTERNAL) {
+			out_printf(o, "GEN := $(intermediates)/%s\n", m->source[i].name);
+			out_printf(o, "$(GEN): PRIVATE_CUSTOM_TOOL = %s\n",
+			       g->command ? g->command : "");
+			out_printf(o, "$(GEN):");
+			for (j = 0; j < g->inputs; j++)
+				out_printf(o, " %s", g->input[j]);
+			out_printf(o, "\n\t$(transform-generated-source)\n");
+			out_printf(o, "LOCAL_GENERATED_SOURCES += $(GEN)\n\n");
+		} else {
+			out_printf(o, "$(LOCAL_PATH)/%s:", m->source[i].name);
+			for (j = 0; j < g->inputs; j++)
+				out_printf(o, " %s", g->input[j]);
+			out_printf(o, "\n\t%s\n", g->command ? g->command : "");
+			if (!is_header(m->source[i].name))
+				out_printf(o, "LOCAL_SRC_FILES += %s\n",
+				       m->source[i].name);
+			out_printf(o, "\n");
 		}
+	}
 
-		emit_libraries(m->library,
-		               m->libraries,
-		               p->btype,
-		               m->libfilter,
-		               m->libfilters);
+	if (p->btype == BUILD_EXTERNAL) {
+		out_printf(o, "LOCAL_C_INCLUDES += $(intermediates)\n\n");
+		return;
+	}
+
+	/* nothing else would make ndk-build generate the headers first */
+	first = 1;
+	for (i = 0; i < m->sources; i++) {
+		if (!m->source[i].gen || !is_header(m->source[i].name))
+			continue;
+		if (first)
+			out_printf(o, "$(addprefix $(LOCAL_PATH)/,$(LOCAL_SRC_FILES)): |");
+		first = 0;
+		out_printf(o, " \\\n\t$(LOCAL_PATH)/%s", m->source[i].name);
+	}
+	if (!first)
+		out_printf(o, "\n\n");
+}
+
+/*
+ * -:EXPORT_SYMBOLS: <module>_exports.h is force included to give whatever
+ * the public headers declare default visibility again, despite
+ * -fvisibility=hidden, and <module>.map is the version script hiding
+ * everything else, static libraries included.  The symbol list lives in
+ * the Android.mk, so the map depends on it.
+ * ndk-build has no LOCAL_ADDITIONAL_DEPENDENCIES, there the sources
+ * get an order-only dependency on both files instead.
+ */
+static void emit_exports(struct output *o, struct project *p,
+			 struct module *m)
+{
+	int i;
+
+	if (!m->export_only)
+		return;
+
+	if (p->btype == BUILD_EXTERNAL) {
+		out_printf(o, "LOCAL_MODULE_CLASS := %s\n", module_class(m->mtype));
+		if (is_host_module(m->mtype))
+			out_printf(o, "LOCAL_IS_HOST_MODULE := true\n");
+		out_printf(o, "exports := $(call local-generated-sources-dir)\n");
+	} else {
+		out_printf(o, "exports := $(LOCAL_PATH)\n");
+	}
+
+	/* relative to LOCAL_PATH, which is on the include path */
+	out_printf(o, "$(exports)/%s_exports.h: PRIVATE_PATH := $(LOCAL_PATH)\n",
+		   m->name);
+	out_printf(o, "$(exports)/%s_exports.h:", m->name);
+	for (i = 0; i < m->export_headers_count; i++)
+		out_printf(o, " %s", m->export_header[i]);
+	out_printf(o, "\n\tprintf '\\043pragma GCC visibility push(default)\\n' > $@\n");
+	if (m->export_headers_count)
+		out_printf(o, "\tprintf '\\043include \"%%s\"\\n' $(patsubst $(PRIVATE_PATH)/%%,%%,$^) >> $@\n");
+	out_printf(o, "\tprintf '\\043pragma GCC visibility pop\\n' >> $@\n");
+
+	out_printf(o, "$(exports)/%s.map: $(lastword $(MAKEFILE_LIST))\n", m->name);
+	out_printf(o, "\tprintf '%%s\\n' '{' 'global:'");
+	for (i = 0; i < m->export_symbols; i++)
+		out_printf(o, " \\\n\t\t'%s;'", m->export_symbol[i]);
+	out_printf(o, " \\\n\t\t'local:' '*;' '};' > $@\n");
+
+	if (p->btype == BUILD_EXTERNAL) {
+		out_printf(o, "LOCAL_GENERATED_SOURCES += $(exports)/%s_exports.h\n",
+			   m->name);
+		out_printf(o, "LOCAL_ADDITIONAL_DEPENDENCIES += $(exports)/%s.map\n",
+			   m->name);
+		out_printf(o, "LOCAL_C_INCLUDES += $(exports) $(LOCAL_PATH)\n");
+	} else {
+		out_printf(o, "$(addprefix $(LOCAL_PATH)/,$(LOCAL_SRC_FILES)): | \\\n");
+		out_printf(o, "\t$(exports)/%s_exports.h $(exports)/%s.map\n",
+			   m->name, m->name);
+	}
+	out_printf(o, "LOCAL_CFLAGS += -include $(exports)/%s_exports.h\n", m->name);
+	out_printf(o, "LOCAL_LDFLAGS += -Wl,--version-script,$(exports)/%s.map\n\n",
+		   m->name);
+}
+
+static void emit_module_start(struct output *o, struct project *p,
+			      struct module *m)
+{
+	out_printf(o, "include $(CLEAR_VARS)\n\n");
+
+	out_printf(o, "LOCAL_MODULE:=%s\n\n", m->name);
+
+	if (m->only_arches && p->btype == BUILD_EXTERNAL) {
+		out_printf(o, "LOCAL_MODULE_TARGET_ARCH := ");
+		emit_arch_list(o, m->only_arches);
+		out_printf(o, "\n\n");
+	}
+/* no tags == no build for the external dir... */
+	if (m->tags) {
+		out_printf(o, "LOCAL_MODULE_TAGS:=");
+		if (m->tags & TAG_USER)
+			out_printf(o, "user ");
+		if (m->tags & TAG_ENG)
+			out_printf(o, "eng ");
+		if (m->tags & TAG_TESTS)
+			out_printf(o, "tests ");
+		if (m->tags & TAG_OPTIONAL)
+			out_printf(o, "optional ");
+		if (m->tags & TAG_DEBUG)
+			out_printf(o, "debug ");
+		out_printf(o, "\n\n");
+	}
+}
+
+static void emit_build(struct output *o, struct project *p, struct module *m)
+{
+	int j;
+
+	emit_module_start(o, p, m);
+
+	if (m->sources)
+		emit_plain_sources(o, m);
+
+	emit_libraries(o, m->library,
+	               m->libraries,
+	               p->btype,
+	               m->libfilter,
+	               m->libfilters, "", ":=");
 
 /* Android passes LOCAL_CPPFLAGS to g++, LOCAL_CXXFLAGS don't exist,
  * and LOCAL_CFLAGS goes to *BOTH* g++ and gcc.
  * Really.
  */
-		emit_flag_array("LOCAL_CFLAGS :=", &m->c);
+	emit_flag_array(o, "LOCAL_CFLAGS :=", &m->c);
 
-		emit_flag_array("LOCAL_CPPFLAGS :=", &m->cxx);
+	emit_flag_array(o, "LOCAL_CPPFLAGS :=", &m->cxx);
 
 /* We only have to add these to CFLAGS because android's going to give them
  * to the c++ compiler anyway...
  */
-		emit_flag_array("LOCAL_CFLAGS +=", &m->cpp);
+	emit_flag_array(o, "LOCAL_CFLAGS +=", &m->cpp);
 
-		emit_flag_array("LOCAL_C_INCLUDES :=", &m->include);
+	emit_flag_array(o, "LOCAL_C_INCLUDES :=", &m->include);
 
-		printf("LOCAL_PRELINK_MODULE := false\n");
+	emit_flag_array(o, "LOCAL_EXPORT_C_INCLUDES :=", &m->export_include);
 
-		if (m->header_target) {
-			printf("LOCAL_COPY_HEADERS_TO := %s\n", m->header_target);
-		}
+	emit_arches(o, p, m);
 
-		if (m->headers) {
-			printf("LOCAL_COPY_HEADERS := \\\n");
-			for (j = 0; j < m->headers - 1; j++)
-				printf("\t%s \\\n",  m->header[j].name);
-			printf("\t%s\n\n", m->header[j].name);
-		}
+	emit_generated(o, p, m);
 
-		if (m->passthrough) {
-			for (j = 0; j < m->passthroughs; j++)
-				printf("%s\n", m->passthrough[j].name);
-			printf("\n");
-		}
+	emit_exports(o, p, m);
+
+	/* ndk-build never prelinks, only say so when asked to care */
+	if (!m->link_startup || p->btype != BUILD_NDK)
+		out_printf(o, "LOCAL_PRELINK_MODULE := false\n");
+
+	if (m->header_target && !m->export_headers) {
+		out_printf(o, "LOCAL_COPY_HEADERS_TO := %s\n", m->header_target);
+	}
+
+	if (m->headers && !m->export_headers) {
+		out_printf(o, "LOCAL_COPY_HEADERS := \\\n");
+		for (j = 0; j < m->headers - 1; j++)
+			out_printf(o, "\t%s \\\n",  m->header[j].name);
+		out_printf(o, "\t%s\n\n", m->header[j].name);
+	}
+
+	if (m->passthroughs) {
+		for (j = 0; j < m->passthroughs; j++)
+			out_printf(o, "%s\n", m->passthrough[j].name);
+		out_printf(o, "\n");
+	}
 
-		switch (p->module[i].mtype) {
-		case MODULE_SHARED_LIBRARY:
-			printf("include $(BUILD_SHARED_LIBRARY)\n");
-			break;
-		case MODULE_STATIC_LIBRARY:
-			printf("include $(BUILD_STATIC_LIBRARY)\n");
-			break;
-		case MODULE_EXECUTABLE:
-			printf("include $(BUILD_EXECUTABLE)\n");
-			break;
-		case MODULE_HOST_SHARED_LIBRARY:
-			printf("include $(BUILD_HOST_SHARED_LIBRARY)\n");
-			break;
-		case MODULE_HOST_STATIC_LIBRARY:
-			printf("include $(BUILD_HOST_STATIC_LIBRARY)\n");
-			break;
-		case MODULE_HOST_EXECUTABLE:
-			printf("include $(BUILD_HOST_EXECUTABLE)\n");
-			break;
-		default:
-			assert(!!!"OH NOES!!!");
+	switch (m->mtype) {
+	case MODULE_SHARED_LIBRARY:
+		out_printf(o, "include $(BUILD_SHARED_LIBRARY)\n");
+		break;
+	case MODULE_STATIC_LIBRARY:
+		out_printf(o, "include $(BUILD_STATIC_LIBRARY)\n");
+		break;
+	case MODULE_EXECUTABLE:
+		out_printf(o, "include $(BUILD_EXECUTABLE)\n");
+		break;
+	case MODULE_HOST_SHARED_LIBRARY:
+		out_printf(o, "include $(BUILD_HOST_SHARED_LIBRARY)\n");
+		break;
+	case MODULE_HOST_STATIC_LIBRARY:
+		out_printf(o, "include $(BUILD_HOST_STATIC_LIBRARY)\n");
+		break;
+	case MODULE_HOST_EXECUTABLE:
+		out_printf(o, "include $(BUILD_HOST_EXECUTABLE)\n");
+		break;
+	default:
+		assert(!!!"OH NOES!!!");
+	}
+}
+
+/* where m's -:PREBUILT_CACHE entry has the build for the current ABI */
+static void emit_cached_file(struct output *o, struct project *p,
+			     struct module *m)
+{
+	out_printf(o, "%s/$(%s)/%s%s", m->prebuilt,
+		   p->btype == BUILD_NDK ? "TARGET_ARCH_ABI" : "TARGET_ARCH",
+		   m->name, m->mtype == MODULE_SHARED_LIBRARY ? ".so" : ".a");
+}
+
+static void emit_prebuilt(struct output *o, struct project *p,
+			  struct module *m)
+{
+	int j;
+
+	emit_module_start(o, p, m);
+
+	if (p->btype == BUILD_NDK) {
+		out_printf(o, "LOCAL_SRC_FILES := ");
+	} else {
+		out_printf(o, "LOCAL_MODULE_CLASS := %s\n", module_class(m->mtype));
+		out_printf(o, "LOCAL_MODULE_SUFFIX := %s\n",
+			   m->mtype == MODULE_SHARED_LIBRARY ? ".so" : ".a");
+		out_printf(o, "LOCAL_PREBUILT_MODULE_FILE := ");
+	}
+	emit_cached_file(o, p, m);
+	out_printf(o, "\n\n");
+
+	/* still wanted by whoever links it, or to install with it */
+	emit_libraries(o, m->library,
+	               m->libraries,
+	               p->btype,
+	               m->libfilter,
+	               m->libfilters, "", ":=");
+	if (p->btype == BUILD_NDK && m->mtype == MODULE_STATIC_LIBRARY)
+		out_printf(o, "LOCAL_EXPORT_LDLIBS := $(LOCAL_LDLIBS)\n");
+
+	emit_flag_array(o, "LOCAL_EXPORT_C_INCLUDES :=", &m->export_include);
+
+	if (m->passthroughs) {
+		for (j = 0; j < m->passthroughs; j++)
+			out_printf(o, "%s\n", m->passthrough[j].name);
+		out_printf(o, "\n");
+	}
+
+	if (p->btype == BUILD_NDK)
+		out_printf(o, "include $(%s)\n",
+			   m->mtype == MODULE_SHARED_LIBRARY ?
+			   "PREBUILT_SHARED_LIBRARY" : "PREBUILT_STATIC_LIBRARY");
+	else
+		out_printf(o, "include $(BUILD_PREBUILT)\n");
+}
+
+/* the androgenizer-cache goal copies what was just built to the cache */
+static void emit_cache_store(struct output *o, struct project *p,
+			     struct module *m)
+{
+	out_printf(o, "\nandrogenizer_cached := ");
+	emit_cached_file(o, p, m);
+	out_printf(o, "\n$(androgenizer_cached): $(LOCAL_BUILT_MODULE)\n");
+	out_printf(o, "\t@mkdir -p $(dir $@)\n");
+	out_printf(o, "\tcp $< $@.tmp && mv $@.tmp $@\n");
+	out_printf(o, "androgenizer-cache: $(androgenizer_cached)\n");
+	out_printf(o, ".PHONY: androgenizer-cache\n");
+}
+
+void emit_module(struct output *o, struct project *p, struct module *m)
+{
+	/* -:MERGE_ABI modules some ABIs don't have */
+	if (m->only_arches && p->btype == BUILD_NDK) {
+		out_printf(o, "ifneq ($(filter ");
+		emit_arch_list(o, m->only_arches);
+		out_printf(o, ",$(TARGET_ARCH)),)\n");
+	}
+
+	/* the entry is there, but maybe not for every ABI */
+	if (m->prebuilt_hit) {
+		out_printf(o, "ifneq ($(wildcard ");
+		emit_cached_file(o, p, m);
+		out_printf(o, "),)\n");
+		emit_prebuilt(o, p, m);
+		out_printf(o, "else\n");
+	}
+
+	emit_build(o, p, m);
+
+	if (m->prebuilt)
+		emit_cache_store(o, p, m);
+	if (m->prebuilt_hit)
+		out_printf(o, "endif\n");
+
+	if (m->only_arches && p->btype == BUILD_NDK)
+		out_printf(o, "endif\n");
+}
+
+/*
+ * Aggregated subdirectories are flattened into this file, with LOCAL_PATH
+ * pointing at each one in turn, instead of being -included.
+ */
+static void emit_subdirs(struct output *o, struct project *p)
+{
+	struct subdir *s;
+	int i, j;
+
+	for (i = 0; i < p->subdirs; i++) {
+		s = &p->subdir[i];
+		if (!s->project) {
+			out_printf(o, "-include $(%s_TOP)/%s/Android.mk\n", p->name, s->name);
+			continue;
 		}
+
+		out_printf(o, "\nLOCAL_PATH:=$(%s_TOP)/%s\n", p->name, s->name);
+		for (j = 0; j < s->project->modules; j++)
+			emit_module(o, s->project, &s->project->module[j]);
+		emit_subdirs(o, s->project);
+	}
+}
+
+void emit_header(struct output *o, struct project *p)
+{
+	out_printf(o, "# This file is generated by androgenizer for:\n");
+	out_printf(o, "# [%s] NDK\n", (p->btype == BUILD_NDK) ? "x" : " ");
+	out_printf(o, "# [%s] system\n\n", (p->btype == BUILD_EXTERNAL) ? "x" : " ");
+
+	out_printf(o, "LOCAL_PATH:=$(call my-dir)\n");
+
+	if (p->stype == SCRIPT_TOP)
+		out_printf(o, "%s_TOP := $(LOCAL_PATH)\n", p->name);
+	else if (p->relocatable && p->rel_top) {
+		out_printf(o, "ifeq ($(%s_TOP),)\n", p->name);
+		out_printf(o, "%s_TOP := $(LOCAL_PATH)/%s\n", p->name, p->rel_top);
+		out_printf(o, "endif\n");
 	}
+}
+
+int emit_file(struct output *o, struct project *p)
+{
+	int i;
+
+	if (!p->streamed)
+		emit_header(o, p);
+
+	for (i = 0; i < p->modules; i++)
+		emit_module(o, p, &p->module[i]);
 
-	for (i = 0; i < p->subdirs; i++)
-		printf("-include $(%s_TOP)/%s/Android.mk\n", p->name, p->subdir[i].name);
+	emit_subdirs(o, p);
 
 	return 0;
 }
@@ -20,6 +20,14 @@
 
 #include "common.h"
 
-int emit_file(struct project *p);
+/* appends the Android.mk for p to o, minus anything -:STREAM wrote */
+int emit_file(struct output *o, struct project *p);
+
+/* the parts of emit_file -:STREAM needs as it goes */
+void emit_header(struct output *o, struct project *p);
+void emit_module(struct output *o, struct project *p, struct module *m);
+
+/* "arm", "x86" etc., as in LOCAL_SRC_FILES_<arch> */
+const char *arch_name(enum arch arch);
 
 #endif /* __EMIT_H__ */
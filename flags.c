@@ -0,0 +1,214 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "flags.h"
+#include "hash.h"
+
+/*
+ * Automake variables stack up, so a module can be handed -O0 ... -O2,
+ * -DFOO=1 ... -DFOO=2 or -fno-x ... -fx.  GCC and clang only honour the
+ * last of each, so the others can go.  Only families known to work that
+ * way are touched: -O, -g<level>, -D/-U of one macro, -std=, and the
+ * -f, -m and -W switches with their no- forms.  -f options taking a
+ * value are left alone unless listed below, many of them accumulate,
+ * like -fsanitize= or -fdebug-prefix-map=.
+ */
+
+/* -f<name>= options that only keep their last value */
+static const char *single_valued[] = {
+	"visibility",
+	"lto",
+	"profile-use",
+	"profile-generate",
+	NULL
+};
+
+/* options followed by an argument of their own, left as they are */
+static const char *separate_arg[] = {
+	"-Xclang",
+	"-Xassembler",
+	"-Xlinker",
+	"-Xpreprocessor",
+	"-mllvm",
+	"-idirafter",
+	"-imacros",
+	"-iquote",
+	"-isystem",
+	"-target",
+	"-x",
+	"-D",
+	"-U",
+	"--param",
+	NULL
+};
+
+static int begins_with(const char *str, const char *with)
+{
+	return strncmp(str, with, strlen(with)) == 0;
+}
+
+static int in_list(const char **list, const char *str, int len)
+{
+	int i;
+
+	for (i = 0; list[i]; i++)
+		if ((int)strlen(list[i]) == len && strncmp(list[i], str, len) == 0)
+			return 1;
+	return 0;
+}
+
+static char *make_key(const char *prefix, const char *name, int len)
+{
+	char *key = malloc(strlen(prefix) + len + 1);
+
+	sprintf(key, "%s%.*s", prefix, len, name);
+	return key;
+}
+
+char *flag_family(const char *flag)
+{
+	const char *name, *eq;
+	int len;
+
+	if (flag[0] != '-' || !flag[1] || in_list(separate_arg, flag, strlen(flag)))
+		return NULL;
+
+	switch (flag[1]) {
+	case 'O':
+		return strdup("-O");
+	case 'g':
+		if (flag[2] && (flag[2] < '0' || flag[2] > '3' || flag[3]))
+			return NULL;
+		return strdup("-g");
+	case 'D':
+	case 'U':
+		return make_key("-D", flag + 2, strcspn(flag + 2, "="));
+	case 's':
+		return begins_with(flag, "-std=") ? strdup("-std=") : NULL;
+	case 'm':
+		if (strcmp(flag, "-marm") == 0 || strcmp(flag, "-mthumb") == 0)
+			return strdup("-marm/-mthumb");
+		break;
+	case 'W':
+		/* -Wl, -Wa, and -Wp, pass options on, they aren't warnings */
+		if (flag[2] && flag[3] == ',')
+			return NULL;
+		break;
+	case 'f':
+		break;
+	default:
+		return NULL;
+	}
+
+	name = flag + 2;
+	if (begins_with(name, "no-"))
+		name += 3;
+	eq = strchr(name, '=');
+	if (eq && flag[1] == 'f' && !in_list(single_valued, name, eq - name))
+		return NULL;
+	/* -Werror=<warning> is a switch of its own */
+	if (eq && flag[1] == 'W' && begins_with(name, "error="))
+		eq = NULL;
+
+	len = eq ? eq - name : (int)strlen(name);
+	if (!len)
+		return NULL;
+	return make_key(flag[1] == 'f' ? "-f" : flag[1] == 'm' ? "-m" : "-W",
+			name, len);
+}
+
+/*
+ * arr[0] to arr[count - 1] end up on the command line in that order.
+ * Going backwards, a flag whose family was already seen is overridden.
+ */
+static void canonicalize_flags(struct flag_array **arr, int count)
+{
+	struct strmap seen;
+	struct flag **seq;
+	char *drop, *key;
+	int i, j, k, n = 0, arg;
+
+	for (i = 0; i < count; i++)
+		n += arr[i]->nr_flags;
+	if (!n)
+		return;
+
+	seq = malloc(n * sizeof(struct flag *));
+	drop = calloc(n, 1);
+	for (i = k = 0; i < count; i++)
+		for (j = 0; j < arr[i]->nr_flags; j++)
+			seq[k++] = &arr[i]->flags[j];
+
+	/* an option's separate argument isn't an option itself */
+	for (i = 0, arg = 0; i < n; i++) {
+		drop[i] = arg ? -1 : 0;
+		arg = !arg && in_list(separate_arg, seq[i]->flag,
+				      strlen(seq[i]->flag));
+	}
+
+	memset(&seen, 0, sizeof(seen));
+	for (i = n - 1; i >= 0; i--) {
+		key = drop[i] ? NULL : flag_family(seq[i]->flag);
+		drop[i] = 0;
+		if (!key)
+			continue;
+		if (strmap_get(&seen, key))
+			drop[i] = 1;
+		else
+			strmap_put(&seen, key, seq[i]);
+		free(key);
+	}
+	strmap_free(&seen);
+
+	for (i = k = 0; i < count; i++) {
+		for (j = n = 0; j < arr[i]->nr_flags; j++, k++)
+			if (!drop[k])
+				arr[i]->flags[n++] = arr[i]->flags[j];
+		arr[i]->nr_flags = n;
+	}
+	free(drop);
+	free(seq);
+}
+
+/*
+ * LOCAL_CFLAGS gets the -:CPPFLAGS after the -:CFLAGS, so those two are
+ * one sequence.  LOCAL_CPPFLAGS and the per-architecture flags only
+ * apply to some sources, so they can't override anything else.
+ */
+void canonicalize_module(struct module *m)
+{
+	struct flag_array *arr[2];
+	int i;
+
+	arr[0] = &m->c;
+	arr[1] = &m->cpp;
+	canonicalize_flags(arr, 2);
+
+	arr[0] = &m->cxx;
+	canonicalize_flags(arr, 1);
+
+	for (i = 0; i < ARCHES; i++) {
+		arr[0] = &m->arch[i].c;
+		canonicalize_flags(arr, 1);
+		arr[0] = &m->arch[i].cxx;
+		canonicalize_flags(arr, 1);
+	}
+}
@@ -0,0 +1,37 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef __FLAGS_H__
+#define __FLAGS_H__
+
+#include "common.h"
+
+/*
+ * The family of compiler options flag belongs to, where only the last
+ * one given counts, eg. "-O" for -O2 or "-fomit-frame-pointer" for
+ * -fno-omit-frame-pointer.  Returns a newly malloc'd key, or NULL if
+ * every occurrence of flag counts.
+ */
+char *flag_family(const char *flag);
+
+/*
+ * -:CANONICAL_FLAGS: drop the compiler flags of m that a later flag of
+ * the same family overrides anyway.
+ */
+void canonicalize_module(struct module *m);
+
+#endif /* __FLAGS_H__ */
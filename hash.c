@@ -0,0 +1,169 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "hash.h"
+
+/* FNV-1a */
+unsigned int str_hash(const char *str)
+{
+	unsigned int h = 2166136261u;
+
+	while (*str) {
+		h ^= (unsigned char)*str++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void strset_grow(struct strset *set)
+{
+	const char **old = set->slot;
+	int old_size = set->size;
+	int i, j;
+
+	set->size = old_size ? old_size * 2 : 64;
+	set->slot = calloc(set->size, sizeof(*set->slot));
+
+	for (i = 0; i < old_size; i++) {
+		if (!old[i])
+			continue;
+		j = str_hash(old[i]) & (set->size - 1);
+		while (set->slot[j])
+			j = (j + 1) & (set->size - 1);
+		set->slot[j] = old[i];
+	}
+	free(old);
+}
+
+/*
+ * The set only points at str, the caller keeps it alive for as long
+ * as the set is in use.
+ */
+int strset_add(struct strset *set, const char *str)
+{
+	int i;
+
+	if (2 * (set->count + 1) > set->size)
+		strset_grow(set);
+
+	i = str_hash(str) & (set->size - 1);
+	while (set->slot[i]) {
+		if (strcmp(set->slot[i], str) == 0)
+			return 0;
+		i = (i + 1) & (set->size - 1);
+	}
+	set->slot[i] = str;
+	set->count++;
+	return 1;
+}
+
+void strset_free(struct strset *set)
+{
+	free(set->slot);
+	set->slot = NULL;
+	set->size = 0;
+	set->count = 0;
+}
+
+static void strmap_grow(struct strmap *map)
+{
+	struct strmap_entry *old = map->slot;
+	int old_size = map->size;
+	int i, j;
+
+	map->size = old_size ? old_size * 2 : 64;
+	map->slot = calloc(map->size, sizeof(*map->slot));
+
+	for (i = 0; i < old_size; i++) {
+		if (!old[i].key)
+			continue;
+		j = str_hash(old[i].key) & (map->size - 1);
+		while (map->slot[j].key)
+			j = (j + 1) & (map->size - 1);
+		map->slot[j] = old[i];
+	}
+	free(old);
+}
+
+static struct strmap_entry *strmap_find(struct strmap *map, const char *key)
+{
+	int i;
+
+	if (!map->size)
+		return NULL;
+
+	i = str_hash(key) & (map->size - 1);
+	while (map->slot[i].key) {
+		if (strcmp(map->slot[i].key, key) == 0)
+			return &map->slot[i];
+		i = (i + 1) & (map->size - 1);
+	}
+	return &map->slot[i];
+}
+
+void *strmap_get(struct strmap *map, const char *key)
+{
+	struct strmap_entry *e = strmap_find(map, key);
+
+	return e && e->key ? e->value : NULL;
+}
+
+void strmap_put(struct strmap *map, const char *key, void *value)
+{
+	struct strmap_entry *e;
+
+	if (2 * (map->count + 1) > map->size)
+		strmap_grow(map);
+
+	e = strmap_find(map, key);
+	if (!e->key) {
+		e->key = strdup(key);
+		map->count++;
+	}
+	e->value = value;
+}
+
+const char *strmap_intern(struct strmap *map, const char *str)
+{
+	struct strmap_entry *e;
+
+	if (2 * (map->count + 1) > map->size)
+		strmap_grow(map);
+
+	e = strmap_find(map, str);
+	if (!e->key) {
+		e->key = strdup(str);
+		e->value = e->key;
+		map->count++;
+	}
+	return e->key;
+}
+
+void strmap_free(struct strmap *map)
+{
+	int i;
+
+	for (i = 0; i < map->size; i++)
+		free(map->slot[i].key);
+	free(map->slot);
+	map->slot = NULL;
+	map->size = 0;
+	map->count = 0;
+}
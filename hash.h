@@ -0,0 +1,44 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include "common.h"
+
+unsigned int str_hash(const char *str);
+
+/* returns 1 if str was added, 0 if it was already in the set */
+int strset_add(struct strset *set, const char *str);
+
+void strset_free(struct strset *set);
+
+/* returns the value stored for key, or NULL */
+void *strmap_get(struct strmap *map, const char *key);
+
+/* key is copied, value is only pointed at */
+void strmap_put(struct strmap *map, const char *key, void *value);
+
+/*
+ * returns the map's own copy of str, the same pointer for equal strings,
+ * valid until strmap_free
+ */
+const char *strmap_intern(struct strmap *map, const char *str);
+
+void strmap_free(struct strmap *map);
+
+#endif /* __HASH_H__ */
@@ -17,116 +17,90 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
-#include "emit.h"
-#include "options.h"
-#include "common.h"
+#include <string.h>
+#include "androgenizer.h"
+#include "watch.h"
 
-static void cleanup_flag(struct flag *c)
-{
-	free(c->flag);
-}
-
-static void cleanup_flag_array(struct flag_array *arr)
-{
-	int i;
-
-	for (i = 0; i < arr->nr_flags; ++i)
-		cleanup_flag(&arr->flags[i]);
-	free(arr->flags);
-}
-
-static void cleanup_header(struct header *h)
-{
-	free(h->name);
-}
-
-static void cleanup_sources(struct source *s)
-{
-	free(s->name);
-}
-
-static void cleanup_library(struct library *l)
-{
-	free(l->name);
-}
-
-static void cleanup_passthrough(struct passthrough *p)
-{
-	free(p->name);
-}
-
-static void cleanup_module(struct module *m)
+/*
+ * --both <NDK Android.mk> <system Android.mk> <arguments>: one run writes
+ * both variants.  Root paths are stripped as the arguments are parsed,
+ * so each gets its own parse of them.
+ */
+static int both(int argc, char **argv)
 {
-	int i;
-
-	free(m->name);
-
-	if (m->header_target)
-		free(m->header_target);
-
-	if (m->headers) {
-		for (i = 0; i < m->headers; i++)
-			cleanup_header(&m->header[i]);
-		free(m->header);
-	}
-
-	if (m->sources) {
-		for (i = 0; i < m->sources; i++)
-			cleanup_sources(&m->source[i]);
-		free(m->source);
-	}
-
-	cleanup_flag_array(&m->c);
-	cleanup_flag_array(&m->cpp);
-	cleanup_flag_array(&m->cxx);
-	cleanup_flag_array(&m->include);
-
-	if (m->libraries) {
-		for (i = 0; i < m->libraries; i++)
-			cleanup_library(&m->library[i]);
-		free(m->library);
+	static const enum androgenizer_build builds[] = {
+		ANDROGENIZER_BUILD_NDK,
+		ANDROGENIZER_BUILD_SYSTEM,
+	};
+	struct androgenizer *a;
+	const char *buf;
+	char *out[2] = { NULL, NULL };
+	size_t len[2];
+	FILE *f;
+	int i, err = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: androgenizer --both <NDK Android.mk> <system Android.mk> <arguments>\n");
+		return 1;
 	}
 
-	if (m->passthroughs) {
-		for (i = 0; i < m->passthroughs; i++)
-			cleanup_passthrough(&m->passthrough[i]);
-		free(m->passthrough);
+	/* generate both before writing either, so an error leaves neither */
+	a = androgenizer_new();
+	for (i = 0; i < 2 && !err; i++) {
+		androgenizer_set_build(a, builds[i]);
+		err = androgenizer_parse(a, argc - 2,
+					 (const char *const *)argv + 2);
+		if (!err)
+			err = androgenizer_emit(a, &buf, &len[i]);
+		if (err) {
+			fprintf(stderr, "Error in command line: %s\n",
+				androgenizer_error(a) ?
+				androgenizer_error(a) : "no project");
+			break;
+		}
+		out[i] = malloc(len[i]);
+		memcpy(out[i], buf, len[i]);
 	}
-}
-
-static void cleanup_subdir(struct subdir *s)
-{
-	free(s->name);
-}
-
-static void cleanup(struct project *p)
-{
-	int i;
-	if (p->modules) {
-		for (i = 0; i < p->modules; i++)
-			cleanup_module(&p->module[i]);
-		free(p->module);
-	}
-	if (p->subdirs) {
-		for (i = 0; i < p->subdirs; i++)
-			cleanup_subdir(&p->subdir[i]);
-		free(p->subdir);
+	androgenizer_free(a);
+
+	for (i = 0; i < 2 && !err; i++) {
+		f = fopen(argv[i], "w");
+		if (!f || fwrite(out[i], 1, len[i], f) != len[i]) {
+			perror(argv[i]);
+			err = 1;
+		}
+		if (f && fclose(f) != 0 && !err) {
+			perror(argv[i]);
+			err = 1;
+		}
 	}
-	free(p->name);
-	free(p->abs_top);
-	free(p->rel_top);
-	free(p);
+	free(out[0]);
+	free(out[1]);
+	return err ? 1 : 0;
 }
 
 int main(int argc, char **argv)
 {
-	struct project *p;
-	int err = 0;
-
-	p = options_parse(argc, argv);
-	if (p) {
-		err = emit_file(p);
-		cleanup(p);
-	}
-	return err;
+	struct androgenizer *a;
+	const char *buf;
+	size_t len;
+	int err;
+
+	if (argc > 1 && strcmp(argv[1], "--watch") == 0)
+		return watch(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "--both") == 0)
+		return both(argc - 2, argv + 2);
+
+	a = androgenizer_new();
+	androgenizer_set_output(a, stdout);
+
+	err = androgenizer_parse(a, argc - 1, (const char *const *)argv + 1);
+	if (err == ANDROGENIZER_ERROR_ARGS)
+		fprintf(stderr, "Error in command line: %s\n",
+			androgenizer_error(a));
+	else
+		androgenizer_emit(a, &buf, &len);
+
+	androgenizer_free(a);
+	return err ? 1 : 0;
 }
@@ -0,0 +1,464 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cleanup.h"
+#include "common.h"
+#include "emit.h"
+#include "hash.h"
+#include "merge.h"
+
+/*
+ * Running configure once per ABI gives each ABI its own sources, flags
+ * and libraries for the same modules.  Whatever every ABI building a
+ * module has is kept as it is, in the first ABI's order, and the rest
+ * moves to the module's arch sets.  Differing -I paths become -I flags,
+ * there's no per-architecture LOCAL_C_INCLUDES, and differing
+ * -:CPPFLAGS go with the -:CFLAGS, where they'd end up anyway.
+ * Everything else about a module comes from the first ABI building it,
+ * and host modules are taken from there as they are.
+ */
+
+/* one ABI's build of a module */
+struct instance {
+	struct module *m;
+	enum arch arch;
+};
+
+enum arch arch_from_name(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARCHES; i++)
+		if (strcmp(name, arch_name(i)) == 0)
+			return i;
+	return ARCHES;
+}
+
+static void merge_error(struct androgenizer *ctx, const char *fmt,
+			const char *a, const char *b)
+{
+	if (ctx->error)
+		return;
+	ctx->error = malloc(strlen(fmt) + strlen(a) + strlen(b) + 1);
+	sprintf(ctx->error, fmt, a, b);
+}
+
+static int is_host(enum module_type mtype)
+{
+	return mtype == MODULE_HOST_SHARED_LIBRARY ||
+	       mtype == MODULE_HOST_STATIC_LIBRARY ||
+	       mtype == MODULE_HOST_EXECUTABLE;
+}
+
+/* counts the instances having key, each of them once */
+static void count_key(struct strmap *counts, struct strset *seen,
+		      const char *key)
+{
+	if (!strset_add(seen, key))
+		return;
+	strmap_put(counts, key, (void *)((long)strmap_get(counts, key) + 1));
+}
+
+static int is_common(struct strmap *counts, const char *key, int n)
+{
+	return (long)strmap_get(counts, key) == n;
+}
+
+/* the sources in builds, its arch set's after the others, or NULL */
+static struct source *nth_source(struct instance *in, int i)
+{
+	struct arch_set *a = &in->m->arch[in->arch];
+
+	if (i < in->m->sources)
+		return &in->m->source[i];
+	i -= in->m->sources;
+	return i < a->sources ? &a->source[i] : NULL;
+}
+
+static struct source *find_source(struct instance *in, const char *name)
+{
+	struct source *s;
+	int i;
+
+	for (i = 0; (s = nth_source(in, i)); i++)
+		if (strcmp(s->name, name) == 0)
+			return s;
+	return NULL;
+}
+
+static int same_generator(struct generator *a, struct generator *b)
+{
+	int i;
+
+	if (!a || !b)
+		return a == b;
+	if (a->inputs != b->inputs ||
+	    strcmp(a->command ? a->command : "", b->command ? b->command : ""))
+		return 0;
+	for (i = 0; i < a->inputs; i++)
+		if (strcmp(a->input[i], b->input[i]) != 0)
+			return 0;
+	return 1;
+}
+
+static void append_source(struct source **s, int *count, const char *name,
+			  struct generator *gen)
+{
+	(*count)++;
+	*s = realloc(*s, *count * sizeof(struct source));
+	(*s)[*count - 1].name = strdup(name);
+	(*s)[*count - 1].gen = gen;
+}
+
+/* generated sources can't be per architecture, they have to be common */
+static int merge_sources(struct androgenizer *ctx, struct module *out,
+			 struct instance *in, int n)
+{
+	struct strmap counts;
+	struct strset seen;
+	struct arch_set *a;
+	struct source *s;
+	int i, k, ret = -1;
+
+	memset(&counts, 0, sizeof(counts));
+	for (k = 0; k < n; k++) {
+		memset(&seen, 0, sizeof(seen));
+		for (i = 0; (s = nth_source(&in[k], i)); i++)
+			count_key(&counts, &seen, s->name);
+		strset_free(&seen);
+	}
+
+	for (k = 0; k < n; k++) {
+		a = &out->arch[in[k].arch];
+		memset(&seen, 0, sizeof(seen));
+		for (i = 0; (s = nth_source(&in[k], i)); i++) {
+			if (!strset_add(&seen, s->name))
+				continue;
+			if (!is_common(&counts, s->name, n)) {
+				if (s->gen) {
+					merge_error(ctx, "generated source '%s' of module '%s' isn't built for every ABI",
+						    s->name, out->name);
+					strset_free(&seen);
+					goto out;
+				}
+				append_source(&a->source, &a->sources,
+					      s->name, NULL);
+			} else if (k == 0) {
+				append_source(&out->source, &out->sources,
+					      s->name, s->gen);
+			} else if (!same_generator(find_source(&in[0], s->name)->gen,
+						   s->gen)) {
+				merge_error(ctx, "source '%s' of module '%s' isn't generated the same way for every ABI",
+					    s->name, out->name);
+				strset_free(&seen);
+				goto out;
+			}
+		}
+		strset_free(&seen);
+	}
+	ret = 0;
+out:
+	strmap_free(&counts);
+	return ret;
+}
+
+/* the flags in from, then more, or NULL */
+static struct flag *nth_flag(struct flag_array *from,
+			     struct flag_array *more, int i)
+{
+	if (i < from->nr_flags)
+		return &from->flags[i];
+	i -= from->nr_flags;
+	return more && i < more->nr_flags ? &more->flags[i] : NULL;
+}
+
+static void append_flag(struct flag_array *arr, const char *flag,
+			const char *path)
+{
+	arr->nr_flags++;
+	arr->flags = realloc(arr->flags, arr->nr_flags * sizeof(*arr->flags));
+	arr->flags[arr->nr_flags - 1].flag = flag;
+	arr->flags[arr->nr_flags - 1].path = path;
+}
+
+/*
+ * from[k], and more[k] if not NULL, are instance k's flags.  Common ones
+ * go to common, the others to own[k], behind prefix.
+ */
+static void merge_flags(struct androgenizer *ctx, int n,
+			struct flag_array **from, struct flag_array **more,
+			struct flag_array *common, struct flag_array **own,
+			const char *prefix)
+{
+	struct strmap counts;
+	struct strset seen;
+	const char *flag;
+	struct flag *f;
+	char *buf;
+	int i, k;
+
+	memset(&counts, 0, sizeof(counts));
+	for (k = 0; k < n; k++) {
+		memset(&seen, 0, sizeof(seen));
+		for (i = 0; (f = nth_flag(from[k], more[k], i)); i++)
+			count_key(&counts, &seen, f->flag);
+		strset_free(&seen);
+	}
+
+	for (k = 0; k < n; k++) {
+		memset(&seen, 0, sizeof(seen));
+		for (i = 0; (f = nth_flag(from[k], more[k], i)); i++) {
+			if (!strset_add(&seen, f->flag))
+				continue;
+			if (is_common(&counts, f->flag, n)) {
+				if (k == 0)
+					append_flag(common, f->flag, f->path);
+				continue;
+			}
+			flag = f->flag;
+			if (*prefix) {
+				buf = malloc(strlen(prefix) + strlen(flag) + 1);
+				sprintf(buf, "%s%s", prefix, flag);
+				flag = strmap_intern(&ctx->strings, buf);
+				free(buf);
+			}
+			append_flag(own[k], flag, f->path);
+		}
+		strset_free(&seen);
+	}
+	strmap_free(&counts);
+}
+
+static const char *library_key(struct androgenizer *ctx, struct library *l)
+{
+	const char *key;
+	char *buf;
+
+	buf = malloc(strlen(l->name) + 16);
+	sprintf(buf, "%d %s", l->ltype, l->name);
+	key = strmap_intern(&ctx->strings, buf);
+	free(buf);
+	return key;
+}
+
+static void append_library(struct library **l, int *count,
+			   struct library *from)
+{
+	(*count)++;
+	*l = realloc(*l, *count * sizeof(struct library));
+	(*l)[*count - 1].name = strdup(from->name);
+	(*l)[*count - 1].ltype = from->ltype;
+}
+
+/* linker flags can repeat, and are kept as often as they're given */
+static void merge_libraries(struct androgenizer *ctx, struct module *out,
+			    struct instance *in, int n)
+{
+	struct strmap counts;
+	struct strset seen;
+	struct arch_set *a;
+	struct library *l;
+	int i, k;
+
+	memset(&counts, 0, sizeof(counts));
+	for (k = 0; k < n; k++) {
+		memset(&seen, 0, sizeof(seen));
+		for (i = 0; i < in[k].m->libraries; i++)
+			count_key(&counts, &seen,
+				  library_key(ctx, &in[k].m->library[i]));
+		strset_free(&seen);
+	}
+
+	for (k = 0; k < n; k++) {
+		a = &out->arch[in[k].arch];
+		for (i = 0; i < in[k].m->libraries; i++) {
+			l = &in[k].m->library[i];
+			if (!is_common(&counts, library_key(ctx, l), n))
+				append_library(&a->library, &a->libraries, l);
+			else if (k == 0)
+				append_library(&out->library, &out->libraries, l);
+		}
+	}
+	strmap_free(&counts);
+}
+
+static void merge_all_flags(struct androgenizer *ctx, struct module *out,
+			    struct instance *in, int n)
+{
+	struct flag_array *from[ARCHES], *more[ARCHES], *own[ARCHES];
+	int k;
+
+	for (k = 0; k < n; k++) {
+		from[k] = &in[k].m->c;
+		more[k] = &in[k].m->arch[in[k].arch].c;
+		own[k] = &out->arch[in[k].arch].c;
+	}
+	merge_flags(ctx, n, from, more, &out->c, own, "");
+
+	for (k = 0; k < n; k++) {
+		from[k] = &in[k].m->cpp;
+		more[k] = NULL;
+	}
+	merge_flags(ctx, n, from, more, &out->cpp, own, "");
+
+	for (k = 0; k < n; k++)
+		from[k] = &in[k].m->include;
+	merge_flags(ctx, n, from, more, &out->include, own, "-I");
+
+	for (k = 0; k < n; k++) {
+		from[k] = &in[k].m->cxx;
+		own[k] = &out->arch[in[k].arch].cxx;
+	}
+	merge_flags(ctx, n, from, more, &out->cxx, own, "");
+}
+
+/*
+ * in[0]'s module is taken over by out, the others are only read.  Out of
+ * total ABIs, n build this module.
+ */
+static int merge_module(struct androgenizer *ctx, struct instance *in, int n,
+			int total, struct module *out)
+{
+	struct module first = *in[0].m;
+	struct module old;
+	int k, ret = 0;
+
+	memset(in[0].m, 0, sizeof(struct module));
+	in[0].m = &first;
+	*out = first;
+
+	if (is_host(first.mtype))
+		return 0;
+
+	for (k = 1; k < n; k++) {
+		if (in[k].m->mtype != first.mtype) {
+			merge_error(ctx, "module '%s' is of a different type for ABI %s",
+				    first.name, arch_name(in[k].arch));
+			cleanup_module(out);
+			return -1;
+		}
+	}
+
+	out->source = NULL;
+	out->sources = 0;
+	memset(&out->c, 0, sizeof(struct flag_array));
+	memset(&out->cpp, 0, sizeof(struct flag_array));
+	memset(&out->cxx, 0, sizeof(struct flag_array));
+	memset(&out->include, 0, sizeof(struct flag_array));
+	memset(out->arch, 0, sizeof(out->arch));
+	out->library = NULL;
+	out->libraries = 0;
+	memset(&out->source_set, 0, sizeof(struct strset));
+	memset(&out->library_set, 0, sizeof(struct strset));
+
+	out->arm_neon = 0;
+	out->only_arches = 0;
+	for (k = 0; k < n; k++) {
+		if (in[k].arch == ARCH_ARM)
+			out->arm_neon = in[k].m->arm_neon;
+		if (n < total)
+			out->only_arches |= 1 << in[k].arch;
+	}
+
+	if (merge_sources(ctx, out, in, n) < 0) {
+		ret = -1;
+	} else {
+		merge_all_flags(ctx, out, in, n);
+		merge_libraries(ctx, out, in, n);
+	}
+
+	/* out has copies of whatever it kept */
+	memset(&old, 0, sizeof(old));
+	old.source = first.source;
+	old.sources = first.sources;
+	old.c = first.c;
+	old.cpp = first.cpp;
+	old.cxx = first.cxx;
+	old.include = first.include;
+	memcpy(old.arch, first.arch, sizeof(old.arch));
+	old.library = first.library;
+	old.libraries = first.libraries;
+	old.source_set = first.source_set;
+	old.library_set = first.library_set;
+	cleanup_module(&old);
+
+	if (ret < 0)
+		cleanup_module(out);
+	return ret;
+}
+
+static struct module *find_module(struct project *p, const char *name)
+{
+	int i;
+
+	for (i = 0; i < p->modules; i++)
+		if (p->module[i].name && strcmp(p->module[i].name, name) == 0)
+			return &p->module[i];
+	return NULL;
+}
+
+struct module *merge_abis(struct androgenizer *ctx, struct project **project,
+			  const enum arch *abi, int count, int *modules)
+{
+	struct instance in[ARCHES];
+	struct module *out = NULL;
+	struct strset done;
+	struct module *m;
+	int i, j, k, n;
+
+	memset(&done, 0, sizeof(done));
+	*modules = 0;
+
+	for (i = 0; i < count; i++) {
+		if (project[i]->subdirs)
+			fprintf(stderr,
+				"androgenizer: Warning: Ignoring the -:SUBDIRs of ABI %s, they belong with -:MERGE_ABI.\n",
+				arch_name(abi[i]));
+
+		for (j = 0; j < project[i]->modules; j++) {
+			m = &project[i]->module[j];
+			if (!m->name || !strset_add(&done, m->name))
+				continue;
+
+			n = 0;
+			for (k = i; k < count; k++) {
+				in[n].m = find_module(project[k], m->name);
+				in[n].arch = abi[k];
+				if (in[n].m)
+					n++;
+			}
+
+			out = realloc(out, (*modules + 1) * sizeof(struct module));
+			if (merge_module(ctx, in, n, count, &out[*modules]) < 0)
+				goto fail;
+			(*modules)++;
+		}
+	}
+	strset_free(&done);
+	return out;
+
+fail:
+	for (i = 0; i < *modules; i++)
+		cleanup_module(&out[i]);
+	free(out);
+	strset_free(&done);
+	*modules = 0;
+	return NULL;
+}
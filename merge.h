@@ -0,0 +1,36 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef __MERGE_H__
+#define __MERGE_H__
+
+#include "common.h"
+
+/* ARCHES if name isn't one of arch_name()'s */
+enum arch arch_from_name(const char *name);
+
+/*
+ * -:MERGE_ABI: abi[i] holds what project[i] was configured for.  Every
+ * module of theirs is merged into one building for all of them, whatever
+ * they have in common once, the rest per architecture.  Returns the
+ * merged modules, *modules of them, or NULL with ctx->error set.  The
+ * projects are left for the caller to free.
+ */
+struct module *merge_abis(struct androgenizer *ctx, struct project **project,
+			  const enum arch *abi, int count, int *modules);
+
+#endif /* __MERGE_H__ */
@@ -24,7 +24,19 @@ OPTION_ENTRY(HOST_SHARED)
 OPTION_ENTRY(HOST_STATIC)
 OPTION_ENTRY(HOST_EXECUTABLE)
 OPTION_ENTRY(SOURCES)
+OPTION_ENTRY(SOURCES_arm)
+OPTION_ENTRY(SOURCES_arm64)
+OPTION_ENTRY(SOURCES_x86)
+OPTION_ENTRY(SOURCES_x86_64)
+OPTION_ENTRY(GENERATED)
+OPTION_ENTRY(GENERATOR)
+OPTION_ENTRY(UNITY)
+OPTION_ENTRY(UNITY_EXCLUDE)
 OPTION_ENTRY(CFLAGS)
+OPTION_ENTRY(CFLAGS_arm)
+OPTION_ENTRY(CFLAGS_arm64)
+OPTION_ENTRY(CFLAGS_x86)
+OPTION_ENTRY(CFLAGS_x86_64)
 OPTION_ENTRY(CPPFLAGS)
 OPTION_ENTRY(CXXFLAGS)
 OPTION_ENTRY(LDFLAGS)
@@ -32,10 +44,27 @@ OPTION_ENTRY(TAGS)
 OPTION_ENTRY(SUBDIR)
 OPTION_ENTRY(HEADER_TARGET)
 OPTION_ENTRY(HEADERS)
+OPTION_ENTRY(EXPORT_HEADERS)
+OPTION_ENTRY(EXPORT_SYMBOLS)
 OPTION_ENTRY(PASSTHROUGH)
 OPTION_ENTRY(REL_TOP)
 OPTION_ENTRY(ABS_TOP)
+OPTION_ENTRY(RELOCATABLE)
+OPTION_ENTRY(PRUNE_INCLUDES)
+OPTION_ENTRY(CANONICAL_FLAGS)
+OPTION_ENTRY(SCAN_INCLUDES)
 OPTION_ENTRY(LIBFILTER_STATIC)
 OPTION_ENTRY(LIBFILTER_WHOLE)
+OPTION_ENTRY(AUTO_LINK)
+OPTION_ENTRY(AGGREGATE)
+OPTION_ENTRY(MERGE_ABI)
+OPTION_ENTRY(PREBUILT_CACHE)
+OPTION_ENTRY(COMPACT_SOURCES)
+OPTION_ENTRY(WARN_DUPLICATES)
+OPTION_ENTRY(PROFILE)
+OPTION_ENTRY(PGO)
+OPTION_ENTRY(PROFILING_VARIANT)
+OPTION_ENTRY(LINK_STARTUP)
+OPTION_ENTRY(STREAM)
 OPTION_ENTRY(END)
 
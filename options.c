@@ -22,9 +22,22 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 #include <errno.h>
+#include "androgenizer.h"
+#include "autolink.h"
+#include "cache.h"
+#include "cleanup.h"
 #include "common.h"
+#include "emit.h"
+#include "flags.h"
+#include "hash.h"
 #include "library.h"
+#include "merge.h"
+#include "options.h"
+#include "profile.h"
+#include "scan.h"
+#include "symbols.h"
 
 #define OPTION_ENTRY(x) MODE_##x,
 enum mode {
@@ -44,13 +57,11 @@ static struct opstrings opstrings[]={
 };
 #undef OPTION_ENTRY
 
-/* need to maintain state for parsing -I<space>path etc. */
-static const char *cflag_space;
-
-void die(char *error)
+/* only the first error is kept, the caller stops parsing on it */
+static void die(struct androgenizer *ctx, const char *error)
 {
-	fprintf(stderr, "Error in command line: %s\n", error);
-	exit(1);
+	if (!ctx->error)
+		ctx->error = strdup(error);
 }
 
 static char *add_slashes(char *in)
@@ -132,11 +143,13 @@ static void set_rel_top(struct project *p, const char *str)
 	p->rel_top = strdup(str);
 }
 
-static struct project *new_project(char *name, enum script_type stype, enum build_type btype)
+static struct project *new_project(struct androgenizer *ctx, char *name,
+				   enum script_type stype, enum build_type btype)
 {
 	const char *varname;
 	struct project *p = calloc(1, sizeof(struct project));
 
+	p->ctx = ctx;
 	p->name = name;
 	p->stype = stype;
 	p->btype = btype;
@@ -151,6 +164,8 @@ static struct project *new_project(char *name, enum script_type stype, enum buil
 	}
 
 	p->root_path = getenv(varname);
+	if (ctx->subdir)
+		p->dir = strdup(ctx->subdir);
 
 	return p;
 }
@@ -199,11 +214,17 @@ static int begins_with(const char *str, const char *with)
  * - replace ./ with $(LOCAL_PATH)
  * - chop off the root path
  * prepend prefix, and return a newly malloc'd string.
+ *
+ * With -:RELOCATABLE nothing machine specific is left: $rel_top and
+ * $abs_top both become $(<project>_TOP), and other relative paths are
+ * taken relative to $(LOCAL_PATH).
  */
-static char *flag_path_subst(struct project *p, const char *prefix,
-			     const char *path)
+static char *path_subst(struct project *p, const char *prefix,
+			const char *path)
 {
 	char *buf;
+	char *topvar = NULL;
+	const char *stripped;
 	int path_len;
 	int abstop_len;
 	const char *abstop = "";
@@ -216,16 +237,39 @@ static char *flag_path_subst(struct project *p, const char *prefix,
 	if (path[0] == '/' && path[1] == '/')
 		path++;
 
-	if (p->abs_top && p->rel_top && begins_with(path, p->rel_top)) {
+	if (p->relocatable) {
+		topvar = malloc(strlen(p->name) + 8);
+		sprintf(topvar, "$(%s_TOP)", p->name);
+	}
+
+	if (p->relocatable && p->rel_top && begins_with(path, p->rel_top)) {
+		path += strlen(p->rel_top);
+		abstop = topvar;
+	} else if (p->abs_top && p->rel_top && begins_with(path, p->rel_top)) {
 		path += strlen(p->rel_top);
 		abstop = p->abs_top;
-	} else if (path[0] == '.') {
-		if (path[1] == 0 || path[1] == '/') {
-			path++;
-			abstop = "$(LOCAL_PATH)";
-		}
-	} else
+	} else if (path[0] == '.' && (path[1] == 0 || path[1] == '/')) {
+		path++;
+		abstop = "$(LOCAL_PATH)";
+	} else if (!p->relocatable) {
 		path = skip_root_path(p, path);
+	} else {
+		stripped = skip_root_path(p, path);
+		if (p->abs_top && begins_with(stripped, p->abs_top) &&
+		    (stripped[strlen(p->abs_top)] == 0 ||
+		     stripped[strlen(p->abs_top)] == '/')) {
+			path = stripped + strlen(p->abs_top);
+			abstop = topvar;
+		} else if (stripped != path) {
+			path = stripped;
+		} else if (path[0] != '/') {
+			abstop = "$(LOCAL_PATH)/";
+		} else {
+			fprintf(stderr,
+				"androgenizer: Warning: Absolute path '%s' can't be made relocatable.\n",
+				path);
+		}
+	}
 
 	path_len = strlen(path);
 	abstop_len = strlen(abstop);
@@ -236,22 +280,135 @@ static char *flag_path_subst(struct project *p, const char *prefix,
 	strcpy(buf + prefix_len, abstop);
 	strcpy(buf + prefix_len + abstop_len, path);
 
+	free(topvar);
 	return buf;
 }
 
+static const char *intern(struct project *p, const char *str)
+{
+	return strmap_intern(&p->ctx->strings, str);
+}
+
+/*
+ * path_subst(), remembered for every project setting it depends on, so
+ * the include paths repeated by every module are only worked out once.
+ * The result is interned.
+ */
+static const char *flag_path_subst(struct project *p, const char *prefix,
+				   const char *path)
+{
+	struct strmap *memo = &p->ctx->path_subst;
+	const char *rel_top = p->rel_top ? p->rel_top : "";
+	const char *abs_top = p->abs_top ? p->abs_top : "";
+	const char *root_path = p->root_path ? p->root_path : "";
+	const char *out;
+	char *key, *buf;
+
+	key = malloc(strlen(p->name) + strlen(rel_top) + strlen(abs_top) +
+		     strlen(root_path) + strlen(prefix) + strlen(path) + 8);
+	sprintf(key, "%s\n%d\n%s\n%s\n%s\n%s\n%s", p->name,
+		!!p->relocatable, rel_top, abs_top, root_path, prefix, path);
+
+	out = strmap_get(memo, key);
+	if (!out) {
+		buf = path_subst(p, prefix, path);
+		out = intern(p, buf);
+		free(buf);
+		strmap_put(memo, key, (void *)out);
+	}
+	free(key);
+	return out;
+}
+
+/* whether each directory exists, ctx->dir_cache is shared by every module */
+static int dir_exists = 1, dir_missing;
+
+static int is_dir(struct androgenizer *ctx, const char *path)
+{
+	struct stat st;
+	int *cached = strmap_get(&ctx->dir_cache, path);
+
+	if (!cached) {
+		cached = (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) ?
+			 &dir_exists : &dir_missing;
+		strmap_put(&ctx->dir_cache, path, cached);
+	}
+	return *cached;
+}
+
+/* relative paths of an -:AGGREGATE subdirectory are relative to it */
+static char *project_path(struct project *p, const char *path)
+{
+	char *out;
+
+	if (!p->dir || path[0] == '/')
+		return strdup(path);
+	out = malloc(strlen(p->dir) + strlen(path) + 2);
+	sprintf(out, "%s/%s", p->dir, path);
+	return out;
+}
+
+/*
+ * With -:PRUNE_INCLUDES, -I directories that don't exist, or are host
+ * paths outside the build root, would only cost the compiler a failed
+ * lookup for every #include, so drop them.  Paths are checked as given,
+ * relative to the project's directory.
+ */
+static int keep_include_dir(struct project *p, struct module *m,
+			    const char *path)
+{
+	char *dir;
+	int exists;
+
+	if (!p->prune_includes)
+		return 1;
+
+	while (*path && isblank(*path))
+		path++;
+
+	if (path[0] == '/' && path[1] == '/')
+		path++;
+
+	if (path[0] == '/' && p->root_path && !begins_with(path, p->root_path)) {
+		fprintf(stderr,
+			"androgenizer: Warning: Dropping include directory '%s' from module '%s', it's outside the build root.\n",
+			path, m->name);
+		return 0;
+	}
+
+	dir = project_path(p, path);
+	exists = is_dir(p->ctx, dir);
+	free(dir);
+	if (!exists) {
+		fprintf(stderr,
+			"androgenizer: Warning: Dropping include directory '%s' from module '%s', it doesn't exist.\n",
+			path, m->name);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * inc is where -I paths go, without the -I.  If it's NULL they stay in
+ * arr as -I flags.
+ */
 static void add_compiler_flag(struct project *p, struct module *m,
-			      struct flag_array *arr, char *flag)
+			      struct flag_array *arr, struct flag_array *inc,
+			      char *flag)
 {
-	char *new_flag;
+	const char *new_flag;
+	const char *path = NULL;
+	char *family;
 	int i;
 
 	if (strcmp("-I", flag) == 0) {
-		cflag_space = "-I";
+		p->ctx->cflag_space = "-I";
 		goto out;
 	}
 
 	if (strcmp("-include", flag) == 0) {
-		cflag_space = "-include ";
+		p->ctx->cflag_space = "-include ";
 		goto out;
 	}
 
@@ -261,33 +418,57 @@ static void add_compiler_flag(struct project *p, struct module *m,
 	if (strcmp("-pthread", flag) == 0)
 		goto out;
 
+	if (begins_with(flag, "-I") && flag[2] &&
+	    !keep_include_dir(p, m, flag + 2))
+		goto out;
+
+	if (p->ctx->cflag_space && strcmp(p->ctx->cflag_space, "-I") == 0 &&
+	    !keep_include_dir(p, m, flag)) {
+		p->ctx->cflag_space = NULL;
+		goto out;
+	}
+
 	/* All -I flags are put in a separate array, without the -I */
 	if (begins_with(flag, "-I")) {
-		new_flag = flag_path_subst(p, "", flag + 2);
-		arr = &m->include;
-	} else if (cflag_space) {
-		if (strcmp(cflag_space, "-I") == 0) {
-			new_flag = flag_path_subst(p, "", flag);
-			arr = &m->include;
+		new_flag = flag_path_subst(p, inc ? "" : "-I", flag + 2);
+		path = intern(p, flag + 2);
+		if (inc)
+			arr = inc;
+	} else if (p->ctx->cflag_space) {
+		if (strcmp(p->ctx->cflag_space, "-I") == 0) {
+			new_flag = flag_path_subst(p, inc ? "" : "-I", flag);
+			path = intern(p, flag);
+			if (inc)
+				arr = inc;
 		} else {
-			new_flag = flag_path_subst(p, cflag_space, flag);
+			/* -include, the path is for -:PREBUILT_CACHE to hash */
+			new_flag = flag_path_subst(p, p->ctx->cflag_space, flag);
+			path = intern(p, flag);
 		}
-		cflag_space = NULL;
+		p->ctx->cflag_space = NULL;
 	} else {
-		new_flag = flag;
-		flag = NULL;
+		new_flag = intern(p, flag);
 	}
 
-	for (i = 0; i < arr->nr_flags; i++) {
-		if (strcmp(new_flag, arr->flags[i].flag) == 0) {
-			free(new_flag);
+	/* interned, so equal flags are the same pointer */
+	for (i = 0; i < arr->nr_flags; i++)
+		if (new_flag == arr->flags[i].flag)
+			break;
+	if (i < arr->nr_flags) {
+		/* it may have to win over something given in between */
+		family = p->canonical_flags ? flag_family(new_flag) : NULL;
+		if (!family)
 			goto out;
-		}
+		free(family);
+		memmove(&arr->flags[i], &arr->flags[i + 1],
+			(arr->nr_flags - i - 1) * sizeof(*arr->flags));
+		arr->nr_flags--;
 	}
 
 	arr->nr_flags++;
 	arr->flags = realloc(arr->flags, arr->nr_flags * sizeof(*arr->flags));
 	arr->flags[arr->nr_flags - 1].flag = new_flag;
+	arr->flags[arr->nr_flags - 1].path = path;
 
 out:
 	free(flag);
@@ -295,17 +476,24 @@ out:
 
 static void add_cflag(struct project *p, struct module *m, char *flag)
 {
-	add_compiler_flag(p, m, &m->c, flag);
+	add_compiler_flag(p, m, &m->c, &m->include, flag);
 }
 
 static void add_cppflag(struct project *p, struct module *m, char *flag)
 {
-	add_compiler_flag(p, m, &m->cpp, flag);
+	add_compiler_flag(p, m, &m->cpp, &m->include, flag);
 }
 
 static void add_cxxflag(struct project *p, struct module *m, char *flag)
 {
-	add_compiler_flag(p, m, &m->cxx, flag);
+	add_compiler_flag(p, m, &m->cxx, &m->include, flag);
+}
+
+/* LOCAL_C_INCLUDES has no per-architecture variant, keep -I in the flags */
+static void add_arch_cflag(struct project *p, struct module *m,
+			   enum arch arch, char *flag)
+{
+	add_compiler_flag(p, m, &m->arch[arch].c, NULL, flag);
 }
 
 static int sources_filter(char *name)
@@ -330,9 +518,28 @@ static int sources_filter(char *name)
 	return 0;
 }
 
-static void add_source(struct module *m, char *name, struct generator *g)
+/*
+ * automake variable concatenation hands us the same source or library
+ * more than once, only the first one is kept.
+ */
+static int is_duplicate(struct project *p, struct module *m,
+			struct strset *set, const char *what, const char *name)
+{
+	if (strset_add(set, name))
+		return 0;
+
+	if (p->warn_duplicates)
+		fprintf(stderr,
+			"androgenizer: Warning: Dropping duplicate %s '%s' from module '%s'.\n",
+			what, name, m->name);
+	return 1;
+}
+
+static void add_source(struct project *p, struct module *m, char *name,
+		       struct generator *g)
 {
-	if (sources_filter(name)) {
+	if (sources_filter(name) ||
+	    is_duplicate(p, m, &m->source_set, "source", name)) {
 		free(name);
 		return;
 	}
@@ -342,8 +549,92 @@ static void add_source(struct module *m, char *name, struct generator *g)
 	m->source[m->sources - 1].gen = g;
 }
 
-static void add_header(struct module *m, char *name)
+static void add_arch_source(struct project *p, struct module *m,
+			    enum arch arch, char *name)
+{
+	struct arch_set *a = &m->arch[arch];
+
+	if (sources_filter(name) ||
+	    is_duplicate(p, m, &a->source_set, "source", name)) {
+		free(name);
+		return;
+	}
+	a->sources++;
+	a->source = realloc(a->source, a->sources * sizeof(struct source));
+	a->source[a->sources - 1].name = name;
+	a->source[a->sources - 1].gen = NULL;
+}
+
+/*
+ * Returns 0, leaving output to the caller, if the module already has it:
+ * the generator would have nothing to generate.
+ */
+static int add_generated(struct module *m, char *output)
+{
+	struct generator *g;
+
+	/* generated headers are wanted too, so no sources_filter() */
+	if (!strset_add(&m->source_set, output))
+		return 0;
+
+	g = calloc(1, sizeof(struct generator));
+	m->generators++;
+	m->generator = realloc(m->generator,
+			       m->generators * sizeof(struct generator *));
+	m->generator[m->generators - 1] = g;
+
+	m->sources++;
+	m->source = realloc(m->source, m->sources * sizeof(struct source));
+	m->source[m->sources - 1].name = output;
+	m->source[m->sources - 1].gen = g;
+	return 1;
+}
+
+/* a path relative to the module, like -:SOURCES, for use in a rule */
+static char *module_path(struct project *p, const char *name)
+{
+	char *path, *out;
+
+	if (name[0] == '/' || begins_with(name, "./") ||
+	    (p->rel_top && begins_with(name, p->rel_top)))
+		return path_subst(p, "", name);
+
+	path = malloc(strlen(name) + 3);
+	sprintf(path, "./%s", name);
+	out = path_subst(p, "", path);
+	free(path);
+	return out;
+}
+
+static void add_generator_input(struct project *p, struct module *m,
+				char *name)
+{
+	struct generator *g = m->generator[m->generators - 1];
+
+	g->inputs++;
+	g->input = realloc(g->input, g->inputs * sizeof(char *));
+	g->input[g->inputs - 1] = module_path(p, name);
+	free(name);
+}
+
+static void add_generator_command(struct module *m, char *word)
+{
+	struct generator *g = m->generator[m->generators - 1];
+	int len = g->command ? strlen(g->command) + 1 : 0;
+
+	g->command = realloc(g->command, len + strlen(word) + 1);
+	if (len)
+		g->command[len - 1] = ' ';
+	strcpy(g->command + len, word);
+	free(word);
+}
+
+static void add_header(struct project *p, struct module *m, char *name)
 {
+	if (is_duplicate(p, m, &m->header_set, "header", name)) {
+		free(name);
+		return;
+	}
 	m->headers++;
 	m->header = realloc(m->header, m->headers * sizeof(struct header));
 	m->header[m->headers - 1].name = name;
@@ -364,15 +655,22 @@ static void add_libfilter(struct module *m, char *name, enum library_type ltype)
 	m->libfilter[m->libfilters - 1].ltype = ltype;
 }
 
-static void add_library(struct module *m, char *name, enum library_type ltype)
+static void add_library(struct project *p, struct module *m, char *name,
+			enum library_type ltype)
 {
+	/* linker flags can legitimately repeat, eg. --whole-archive pairs */
+	if (ltype != LIBRARY_FLAG &&
+	    is_duplicate(p, m, &m->library_set, "library", name)) {
+		free(name);
+		return;
+	}
 	m->libraries++;
 	m->library = realloc(m->library, m->libraries * sizeof(struct library));
 	m->library[m->libraries - 1].name = name;
 	m->library[m->libraries - 1].ltype = ltype;
 }
 
-static int add_ldflag(struct module *m, char *flag, enum build_type btype)
+static int add_ldflag(struct project *p, struct module *m, char *flag)
 {
 	enum library_type ltype;
 	enum flag_action action;
@@ -396,11 +694,11 @@ static int add_ldflag(struct module *m, char *flag, enum build_type btype)
 		/* otherwise we have FLAG_USE */
 		if (flag[1] == 'l') {/* actually figure out what libtype... */
 			ltype = library_scope(flag + 2);
-			add_library(m, strdup(flag+2), ltype);
+			add_library(p, m, strdup(flag+2), ltype);
 			free(flag);
 			return 0;
 		}
-		add_library(m, flag, LIBRARY_FLAG);
+		add_library(p, m, flag, LIBRARY_FLAG);
 	} else {
 		char *dot = rindex(flag, '.');
 
@@ -423,7 +721,7 @@ static int add_ldflag(struct module *m, char *flag, enum build_type btype)
 				temp = flag;
 				flag = strdup(lname + 3);
 				free(temp);
-				add_library(m, flag, LIBRARY_EXTERNAL);
+				add_library(p, m, flag, LIBRARY_EXTERNAL);
 				return 0;
 			}
 			free(flag);
@@ -436,204 +734,1579 @@ static int add_ldflag(struct module *m, char *flag, enum build_type btype)
 	return 0;
 }
 
-static void add_module(struct project *p, struct module *m)
+static int has_flag(struct flag_array *arr, const char *flag)
 {
-	p->modules++;
-	p->module = realloc(p->module, p->modules * sizeof(struct module));
-	p->module[p->modules - 1] = *m;
-	free(m);
+	int i;
+
+	for (i = 0; i < arr->nr_flags; i++)
+		if (strcmp(flag, arr->flags[i].flag) == 0)
+			return 1;
+	return 0;
 }
 
-static void add_subdir(struct project *p, char *name)
+static void insert_flag(struct project *p, struct flag_array *arr, int pos,
+			const char *flag)
 {
-	p->subdirs++;
-	p->subdir = realloc(p->subdir, p->subdirs * sizeof(struct subdir));
-	p->subdir[p->subdirs - 1].name = name;
+	arr->nr_flags++;
+	arr->flags = realloc(arr->flags, arr->nr_flags * sizeof(*arr->flags));
+	memmove(&arr->flags[pos + 1], &arr->flags[pos],
+		(arr->nr_flags - pos - 1) * sizeof(*arr->flags));
+	arr->flags[pos].flag = intern(p, flag);
+	arr->flags[pos].path = NULL;
 }
 
-static enum mode get_mode(char *arg)
+static void insert_library(struct module *m, int pos, const char *flag)
 {
-	int i;
-	int outval = MODE_UNDEFINED;
-	int len = strlen(arg);
+	m->libraries++;
+	m->library = realloc(m->library, m->libraries * sizeof(struct library));
+	memmove(&m->library[pos + 1], &m->library[pos],
+		(m->libraries - pos - 1) * sizeof(struct library));
+	m->library[pos].name = strdup(flag);
+	m->library[pos].ltype = LIBRARY_FLAG;
+}
 
-	if (len < 3)
-		return MODE_UNDEFINED;
-	if ((arg[0] != '-') || (arg[1] != ':'))
-		return MODE_UNDEFINED;
+static void insert_passthrough(struct module *m, int pos, const char *str)
+{
+	m->passthroughs++;
+	m->passthrough = realloc(m->passthrough,
+				 m->passthroughs * sizeof(struct passthrough));
+	memmove(&m->passthrough[pos + 1], &m->passthrough[pos],
+		(m->passthroughs - pos - 1) * sizeof(struct passthrough));
+	m->passthrough[pos].name = strdup(str);
+}
 
-	for  (i = 0; opstrings[i].str != NULL; i++)
-		if (strcmp(opstrings[i].str, arg) == 0)
-			outval = opstrings[i].mode;
+/*
+ * The profile goes in front of whatever the module asked for itself, so
+ * that explicit -:CFLAGS, -:LDFLAGS and -:PASSTHROUGH settings win.
+ */
+static void apply_profile(struct project *p, struct module *m)
+{
+	const struct profile_directive *pd;
+	int cflags = 0, ldflags = 0, passthroughs = 0;
 
-	return outval;
+	if (m->profile == PROFILE_NONE)
+		return;
+
+	for (pd = profile_directives; pd->str; pd++) {
+		if (!profile_applies(pd, m->profile, m->mtype, p->btype))
+			continue;
+
+		switch (pd->kind) {
+		case PROFILE_CFLAG:
+			if (!has_flag(&m->c, pd->str))
+				insert_flag(p, &m->c, cflags++, pd->str);
+			break;
+		case PROFILE_LDFLAG:
+			insert_library(m, ldflags++, pd->str);
+			break;
+		case PROFILE_PASSTHROUGH:
+			insert_passthrough(m, passthroughs++, pd->str);
+			break;
+		}
+	}
 }
 
-static enum module_type module_type_from_mode(enum mode mode)
+/*
+ * -mfpu=neon in -:CFLAGS_arm would apply to every source of the module,
+ * which then can't run on non-NEON cores.  Instead, only the -:SOURCES_arm
+ * kernels get the .neon suffix, or the whole module is LOCAL_ARM_NEON if
+ * it has no other sources.
+ */
+static void apply_arm_neon(struct module *m)
 {
-	switch (mode) {
-	case MODE_SHARED:
-		return MODULE_SHARED_LIBRARY;
-	case MODE_STATIC:
-		return MODULE_STATIC_LIBRARY;
-	case MODE_EXECUTABLE:
-		return MODULE_EXECUTABLE;
-	case MODE_HOST_SHARED:
-		return MODULE_HOST_SHARED_LIBRARY;
-	case MODE_HOST_STATIC:
-		return MODULE_HOST_STATIC_LIBRARY;
-	case MODE_HOST_EXECUTABLE:
-		return MODULE_HOST_EXECUTABLE;
-	default:
-		fprintf(stderr, "Unknown mode %d passed to '%s'.\n", mode, __func__);
-		abort();
+	struct arch_set *a = &m->arch[ARCH_ARM];
+	int i, j, len, neon = 0;
+	char *name;
+
+	for (i = j = 0; i < a->c.nr_flags; i++) {
+		if (strcmp(a->c.flags[i].flag, "-mfpu=neon") == 0) {
+			neon = 1;
+			continue;
+		}
+		a->c.flags[j++] = a->c.flags[i];
+	}
+	a->c.nr_flags = j;
+
+	if (!neon)
+		return;
+
+	if (!m->sources) {
+		m->arm_neon = 1;
+		return;
+	}
+
+	for (i = 0; i < a->sources; i++) {
+		len = strlen(a->source[i].name);
+		if (len > 5 && strcmp(a->source[i].name + len - 5, ".neon") == 0)
+			continue;
+		name = malloc(len + 6);
+		sprintf(name, "%s.neon", a->source[i].name);
+		free(a->source[i].name);
+		a->source[i].name = name;
 	}
 }
 
-static enum build_type guess_build_type(void)
+static void add_export_include(struct project *p, struct module *m,
+			       const char *dir)
 {
-	const char *android_build_top = getenv("ANDROID_BUILD_TOP");
+	struct flag_array *arr = &m->export_include;
+	const char *path;
+	char *buf;
+	int i;
 
-	if (android_build_top && strlen(android_build_top) > 0)
-		return BUILD_EXTERNAL;
+	if (strcmp(dir, ".") == 0) {
+		path = intern(p, "$(LOCAL_PATH)");
+	} else {
+		buf = module_path(p, dir);
+		path = intern(p, buf);
+		free(buf);
+	}
 
-	return BUILD_NDK;
+	for (i = 0; i < arr->nr_flags; i++)
+		if (arr->flags[i].flag == path)
+			return;
+
+	arr->nr_flags++;
+	arr->flags = realloc(arr->flags, arr->nr_flags * sizeof(*arr->flags));
+	arr->flags[arr->nr_flags - 1].flag = path;
+	arr->flags[arr->nr_flags - 1].path = NULL;
 }
 
-struct project *options_parse(int argc, char **args)
+/* whatever follows the last /, or all of path */
+static char *last_component(char *path)
 {
-	enum mode mode = MODE_UNDEFINED;
-	char *arg;
-	int i, skip = 0;
-	enum build_type bt;
-	struct project *p = NULL;
-	struct module *m = NULL;
+	char *slash = strrchr(path, '/');
 
-	bt = guess_build_type();
+	return slash ? slash + 1 : path;
+}
 
-	if (argc < 2) {
-/* print help! */
-		return NULL;
-	}
-	for (i = 1; i < argc; i++) {
-		enum mode nm;
-		nm = get_mode(args[i]);
-		if (mode != MODE_PASSTHROUGH)
-			arg = add_slashes(args[i]);
+/*
+ * With -:EXPORT_HEADERS, instead of copying the headers, the directories
+ * holding them are exported.  Copied headers land in -:HEADER_TARGET,
+ * so wherever its last components match the header's directory, the
+ * parent is exported too, and <target/header.h> keeps working.
+ */
+static void apply_export_headers(struct project *p, struct module *m)
+{
+	char *dir, *target, *slash, *d, *t;
+	int i;
+
+	if (!m->export_headers)
+		return;
+
+	for (i = 0; i < m->headers; i++) {
+		slash = strrchr(m->header[i].name, '/');
+		if (slash)
+			dir = strndup(m->header[i].name,
+				      slash - m->header[i].name);
 		else
-			arg = strdup(args[i]);
+			dir = strdup(".");
+		target = strdup(m->header_target ? m->header_target : "");
+		while (*target && target[strlen(target) - 1] == '/')
+			target[strlen(target) - 1] = 0;
+
+		add_export_include(p, m, dir);
+		while (*target && strcmp(dir, ".") != 0) {
+			t = last_component(target);
+			d = last_component(dir);
+			if (strcmp(d, t) != 0)
+				break;
+
+			/* "." always fits where a component was */
+			if (d == dir)
+				strcpy(dir, ".");
+			else
+				d[-1] = 0;
+			if (t == target)
+				*target = 0;
+			else
+				t[-1] = 0;
 
-		if (nm != MODE_UNDEFINED) {
-			free(arg);
-			skip = 0;
-			mode = nm;
-			continue;
+			add_export_include(p, m, dir);
 		}
+		free(target);
+		free(dir);
+	}
+}
 
-		if (skip) {
-			skip = 0;
-			free(arg);
-			continue;
-		}
+/*
+ * With -:EXPORT_SYMBOLS everything is built with hidden visibility, except
+ * for what the -:HEADERS declare, and a version script keeps only those
+ * and the allowlist in the dynamic symbol table.  emit_exports() writes
+ * the rules.
+ */
+static void apply_export_symbols(struct project *p, struct module *m)
+{
+	const char *unreadable;
+	char *error;
+	int i;
 
-		switch (mode) {
-		case MODE_UNDEFINED:
-			die("Androgenizer arguments must start with a valid -: switch, like -:PROJECT.");
-			break;
-		case MODE_PROJECT:
-			p = new_project(arg, SCRIPT_SUBDIRECTORY, bt);
-			break;
-		case MODE_SUBDIR:
-			if (!p)
-				die("-:PROJECT must come before -:SUBDIR");
-			add_subdir(p, arg);
-			break;
-		case MODE_SHARED:
-		case MODE_STATIC:
-		case MODE_EXECUTABLE:
-		case MODE_HOST_SHARED:
-		case MODE_HOST_STATIC:
-		case MODE_HOST_EXECUTABLE:
-			if (!p)
-				die("-:PROJECT must come before a module type");
-			if (m)
-				add_module(p, m);
-			m = new_module(arg, module_type_from_mode(mode));
-			break;
-		case MODE_SOURCES:
-			if (!m)
-				die("a module type must be declared before adding -:SOURCES");
-			add_source(m, arg, NULL);
+	if (!m->export_only)
+		return;
+
+	insert_flag(p, &m->c, m->c.nr_flags, "-fvisibility=hidden");
+	/* a version script missing them would hide everything */
+	unreadable = scan_symbols(m, p->dir);
+	if (unreadable) {
+		error = malloc(strlen(unreadable) + 64);
+		sprintf(error, "can't read -:HEADERS file '%s' for -:EXPORT_SYMBOLS",
+			unreadable);
+		die(p->ctx, error);
+		free(error);
+		return;
+	}
+
+	m->export_headers_count = m->headers;
+	m->export_header = malloc(m->headers * sizeof(char *));
+	for (i = 0; i < m->headers; i++)
+		m->export_header[i] = module_path(p, m->header[i].name);
+}
+
+/*
+ * -:LINK_STARTUP: what a shared library costs at load time is mostly
+ * relocation processing, so the relocations are packed, and symbols are
+ * looked up through a GNU hash table.  Bionic always binds immediately,
+ * so there -z now only adds full RELRO for free; lazy binding is only
+ * for host libraries.
+ */
+static void apply_link_startup(struct project *p, struct module *m)
+{
+	int host = m->mtype == MODULE_HOST_SHARED_LIBRARY;
+
+	if (m->link_startup == LINK_DEFAULT)
+		return;
+
+	if (m->link_startup == LINK_LAZY && !host) {
+		fprintf(stderr,
+			"androgenizer: Warning: Android doesn't do lazy binding, linking '%s' with -z now.\n",
+			m->name);
+		m->link_startup = LINK_NOW;
+	}
+
+	/* loaders before API 23 only know the SysV hash table */
+	insert_library(m, m->libraries, "-Wl,--hash-style=both");
+	insert_library(m, m->libraries, "-Wl,-z,relro");
+	insert_library(m, m->libraries, m->link_startup == LINK_NOW ?
+			"-Wl,-z,now" : "-Wl,-z,lazy");
+
+	/* and can't load packed relocations, the NDK has to be told */
+	if (host || (p->btype == BUILD_NDK && !m->pack_relocations))
+		return;
+	if (p->btype == BUILD_NDK)
+		insert_library(m, m->libraries, "-Wl,--pack-dyn-relocs=android");
+	else
+		insert_passthrough(m, m->passthroughs,
+				   "LOCAL_PACK_MODULE_RELOCATIONS := true");
+}
+
+static int module_links(struct module *m)
+{
+	return m->mtype != MODULE_STATIC_LIBRARY &&
+	       m->mtype != MODULE_HOST_STATIC_LIBRARY;
+}
+
+static void copy_flag_array(struct flag_array *dst, struct flag_array *src)
+{
+	dst->nr_flags = src->nr_flags;
+	dst->flags = NULL;
+	if (!src->nr_flags)
+		return;
+	dst->flags = malloc(src->nr_flags * sizeof(*src->flags));
+	memcpy(dst->flags, src->flags, src->nr_flags * sizeof(*src->flags));
+}
+
+static struct source *copy_sources(struct source *src, int count)
+{
+	struct source *dst;
+	int i;
+
+	if (!count)
+		return NULL;
+
+	dst = malloc(count * sizeof(struct source));
+	for (i = 0; i < count; i++) {
+		dst[i].name = strdup(src[i].name);
+		dst[i].gen = src[i].gen;
+	}
+	return dst;
+}
+
+static struct library *copy_libraries(struct library *src, int count)
+{
+	struct library *dst;
+	int i;
+
+	if (!count)
+		return NULL;
+
+	dst = malloc(count * sizeof(struct library));
+	for (i = 0; i < count; i++) {
+		dst[i].name = strdup(src[i].name);
+		dst[i].ltype = src[i].ltype;
+	}
+	return dst;
+}
+
+static char **copy_strings(char **src, int count)
+{
+	char **dst;
+	int i;
+
+	if (!count)
+		return NULL;
+	dst = malloc(count * sizeof(char *));
+	for (i = 0; i < count; i++)
+		dst[i] = strdup(src[i]);
+	return dst;
+}
+
+static struct generator *copy_generator(struct generator *src)
+{
+	struct generator *dst = calloc(1, sizeof(struct generator));
+
+	dst->inputs = src->inputs;
+	dst->input = copy_strings(src->input, src->inputs);
+	dst->command = src->command ? strdup(src->command) : NULL;
+	return dst;
+}
+
+/*
+ * A deep copy of a finished module under the name <name><suffix>, for
+ * building a variant of it next to the original.  Headers aren't copied,
+ * both modules copying them to the same place would conflict.
+ */
+static struct module *clone_module(struct module *m, const char *suffix)
+{
+	struct module *out = calloc(1, sizeof(struct module));
+	int i, j;
+
+	*out = *m;
+
+	out->name = malloc(strlen(m->name) + strlen(suffix) + 1);
+	sprintf(out->name, "%s%s", m->name, suffix);
+
+	out->header_target = NULL;
+	out->header = NULL;
+	out->headers = 0;
+
+	out->source = copy_sources(m->source, m->sources);
+	copy_flag_array(&out->c, &m->c);
+	copy_flag_array(&out->cpp, &m->cpp);
+	copy_flag_array(&out->cxx, &m->cxx);
+	copy_flag_array(&out->include, &m->include);
+	copy_flag_array(&out->export_include, &m->export_include);
+
+	for (i = 0; i < ARCHES; i++) {
+		out->arch[i].source = copy_sources(m->arch[i].source,
+						   m->arch[i].sources);
+		copy_flag_array(&out->arch[i].c, &m->arch[i].c);
+		copy_flag_array(&out->arch[i].cxx, &m->arch[i].cxx);
+		out->arch[i].library = copy_libraries(m->arch[i].library,
+						      m->arch[i].libraries);
+		memset(&out->arch[i].source_set, 0, sizeof(struct strset));
+	}
+
+	out->generator = NULL;
+	if (m->generators)
+		out->generator = malloc(m->generators *
+					sizeof(struct generator *));
+	for (i = 0; i < m->generators; i++) {
+		out->generator[i] = copy_generator(m->generator[i]);
+		for (j = 0; j < m->sources; j++)
+			if (m->source[j].gen == m->generator[i])
+				out->source[j].gen = out->generator[i];
+	}
+
+	out->library = copy_libraries(m->library, m->libraries);
+	out->libfilter = copy_libraries(m->libfilter, m->libfilters);
+
+	out->passthrough = NULL;
+	if (m->passthroughs)
+		out->passthrough = malloc(m->passthroughs *
+					  sizeof(struct passthrough));
+	for (i = 0; i < m->passthroughs; i++)
+		out->passthrough[i].name = strdup(m->passthrough[i].name);
+
+	/* the sets point into the original's strings */
+	memset(&out->source_set, 0, sizeof(struct strset));
+	memset(&out->header_set, 0, sizeof(struct strset));
+	memset(&out->library_set, 0, sizeof(struct strset));
+
+	out->pgo_profile = NULL;
+	out->pgo_suffix = NULL;
+	out->prebuilt = NULL;
+	out->unity_exclude = NULL;
+	out->unity_excludes = 0;
+	out->export_symbol = copy_strings(m->export_symbol, m->export_symbols);
+	out->export_header = copy_strings(m->export_header,
+					  m->export_headers_count);
+
+	return out;
+}
+
+/*
+ * With -:STREAM a closed module is written out and freed right away, so
+ * memory doesn't grow with the number of modules.  Aggregated
+ * subdirectories are always kept, emit_subdirs writes them after the
+ * top-level modules.
+ */
+static void stream_module(struct project *p, struct module *m)
+{
+	struct output *o = &p->ctx->out;
+
+	if (!p->streamed)
+		emit_header(o, p);
+	p->streamed++;
+
+	emit_module(o, p, m);
+	cleanup_module(m);
+	free(m);
+}
+
+static void append_module(struct project *p, struct module *m)
+{
+	/*
+	 * -:AUTO_LINK, -:PROFILING_VARIANT and -:PREBUILT_CACHE need to see
+	 * every module first
+	 */
+	if (p->stream && !p->auto_link && !p->profiling_suffix &&
+	    !p->prebuilt_cache && !p->ctx->aggregate_depth) {
+		stream_module(p, m);
+		return;
+	}
+
+	p->modules++;
+	p->module = realloc(p->module, p->modules * sizeof(struct module));
+	p->module[p->modules - 1] = *m;
+	free(m);
+}
+
+static void pgo_instrument(struct project *p, struct module *m)
+{
+	insert_flag(p, &m->c, m->c.nr_flags, "-fprofile-generate");
+	if (module_links(m))
+		insert_library(m, m->libraries, "-fprofile-generate");
+}
+
+/*
+ * -:PGO generate instruments the module, or with a suffix adds an
+ * instrumented copy of it so the two can live side by side.
+ * -:PGO use builds the module with the collected profile.
+ * Returns the instrumented copy, if any, for the caller to add after m.
+ */
+static struct module *apply_pgo(struct project *p, struct module *m)
+{
+	struct module *instrumented = NULL;
+	const char *flag;
+
+	if (m->pgo_generate && m->pgo_suffix) {
+		instrumented = clone_module(m, m->pgo_suffix);
+		pgo_instrument(p, instrumented);
+	} else if (m->pgo_generate) {
+		pgo_instrument(p, m);
+	}
+
+	if (m->pgo_profile) {
+		flag = flag_path_subst(p, "-fprofile-use=", m->pgo_profile);
+		insert_flag(p, &m->c, m->c.nr_flags, flag);
+		if (module_links(m))
+			insert_library(m, m->libraries, flag);
+	}
+
+	return instrumented;
+}
+
+/* module names of p and its aggregated subdirectories */
+static void collect_names(struct project *p, struct strmap *names)
+{
+	int i;
+
+	for (i = 0; i < p->modules; i++)
+		strmap_put(names, p->module[i].name, p);
+	for (i = 0; i < p->subdirs; i++)
+		if (p->subdir[i].project)
+			collect_names(p->subdir[i].project, names);
+}
+
+/* libraries that are modules of the tree get their variant's name */
+static void rename_siblings(struct library *l, int count,
+			    struct strmap *names, const char *suffix)
+{
+	char *lib, *name;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (l[i].ltype == LIBRARY_FLAG || l[i].ltype == LIBRARY_NDK)
+			continue;
+		lib = malloc(strlen(l[i].name) + 4);
+		sprintf(lib, "lib%s", l[i].name);
+		if (strmap_get(names, lib)) {
+			name = malloc(strlen(l[i].name) + strlen(suffix) + 1);
+			sprintf(name, "%s%s", l[i].name, suffix);
+			free(l[i].name);
+			l[i].name = name;
+		}
+		free(lib);
+	}
+}
+
+/*
+ * What profilers need to walk the stack and symbolize: frame pointers,
+ * unwind tables and debug info, and on the device an unstripped module.
+ * Appended, so they win over the module's own -fomit-frame-pointer etc.
+ */
+static void profiling_instrument(struct project *top, struct project *p,
+				 struct module *m, struct strmap *names)
+{
+	const char *suffix = top->profiling_suffix;
+	int i;
+
+	insert_flag(p, &m->c, m->c.nr_flags, "-fno-omit-frame-pointer");
+	insert_flag(p, &m->c, m->c.nr_flags, "-funwind-tables");
+	insert_flag(p, &m->c, m->c.nr_flags, "-g");
+	if (top->profiling_instrument)
+		insert_flag(p, &m->c, m->c.nr_flags, "-finstrument-functions");
+
+	if (m->mtype == MODULE_SHARED_LIBRARY || m->mtype == MODULE_EXECUTABLE)
+		insert_passthrough(m, m->passthroughs,
+				   p->btype == BUILD_NDK ?
+				   "LOCAL_STRIP_MODE := --strip-debug" :
+				   "LOCAL_STRIP_MODULE := keep_symbols");
+
+	rename_siblings(m->library, m->libraries, names, suffix);
+	rename_siblings(m->libfilter, m->libfilters, names, suffix);
+	for (i = 0; i < ARCHES; i++)
+		rename_siblings(m->arch[i].library, m->arch[i].libraries,
+				names, suffix);
+
+	if (p->canonical_flags)
+		canonicalize_module(m);
+}
+
+static void add_profiling_variants(struct project *top, struct project *p,
+				   struct strmap *names)
+{
+	struct module *module, *variant;
+	int i, modules = 0;
+
+	module = malloc(2 * p->modules * sizeof(struct module));
+	for (i = 0; i < p->modules; i++) {
+		variant = clone_module(&p->module[i], top->profiling_suffix);
+		profiling_instrument(top, p, variant, names);
+		module[modules++] = p->module[i];
+		module[modules++] = *variant;
+		free(variant);
+	}
+	free(p->module);
+	p->module = module;
+	p->modules = modules;
+
+	for (i = 0; i < p->subdirs; i++)
+		if (p->subdir[i].project)
+			add_profiling_variants(top, p->subdir[i].project, names);
+}
+
+/*
+ * -:PROFILING_VARIANT: next to every module of the tree, a copy of it
+ * named <module><suffix> built for profiling, which links the profiling
+ * variants of the other modules of the tree instead of the modules
+ * themselves.  Either set can then be installed without regenerating.
+ */
+static void profiling_variants(struct project *p)
+{
+	struct strmap names;
+
+	memset(&names, 0, sizeof(names));
+	collect_names(p, &names);
+	add_profiling_variants(p, p, &names);
+	strmap_free(&names);
+}
+
+static const char *unity_suffix(const char *name)
+{
+	static const char *c_suffixes[] = { ".c", NULL };
+	static const char *cpp_suffixes[] = { ".cpp", ".cc", ".cxx", NULL };
+	const char *dot = strrchr(name, '.');
+	int i;
+
+	if (!dot)
+		return NULL;
+	for (i = 0; c_suffixes[i]; i++)
+		if (strcmp(dot, c_suffixes[i]) == 0)
+			return ".c";
+	for (i = 0; cpp_suffixes[i]; i++)
+		if (strcmp(dot, cpp_suffixes[i]) == 0)
+			return ".cpp";
+	return NULL;
+}
+
+static int unity_excluded(struct module *m, const char *name)
+{
+	int i;
+
+	for (i = 0; i < m->unity_excludes; i++)
+		if (strcmp(m->unity_exclude[i], name) == 0)
+			return 1;
+	return 0;
+}
+
+static int can_batch(struct module *m, int i, const char *suffix)
+{
+	const char *lang = unity_suffix(m->source[i].name);
+
+	return !m->source[i].gen && lang && strcmp(lang, suffix) == 0 &&
+	       !unity_excluded(m, m->source[i].name);
+}
+
+/*
+ * -:UNITY <n> replaces the module's C and C++ sources by generated
+ * batches each #including up to n of them, so headers and forced
+ * includes are only compiled once per batch.  A batch takes the place
+ * of its first source, C and C++ are batched separately and generated
+ * or -:UNITY_EXCLUDE sources are left alone.  The batch #includes its
+ * sources as given, relative to $(LOCAL_PATH), which is added to the
+ * include path.  \043 is printf for the '#' that make would take for a
+ * comment.
+ */
+static void apply_unity(struct project *p, struct module *m)
+{
+	struct source *out;
+	struct generator *g = NULL;
+	const char *suffix;
+	char *command;
+	int i, j, n = 0, batches = 0;
+	int *batched;
+
+	if (m->unity < 2)
+		return;
+
+	out = malloc(m->sources * sizeof(struct source));
+	batched = calloc(m->sources, sizeof(int));
+
+	for (i = 0; i < m->sources; i++) {
+		if (batched[i])
+			continue;
+
+		suffix = unity_suffix(m->source[i].name);
+		if (!suffix || !can_batch(m, i, suffix)) {
+			out[n++] = m->source[i];
+			continue;
+		}
+
+		/* a batch of one would gain nothing */
+		for (j = i + 1; j < m->sources; j++)
+			if (!batched[j] && can_batch(m, j, suffix))
+				break;
+		if (j == m->sources) {
+			out[n++] = m->source[i];
+			continue;
+		}
+
+		/*
+		 * Sources are #included as given, relative to LOCAL_PATH, so
+		 * the batches are the same in every checkout.
+		 */
+		g = calloc(1, sizeof(struct generator));
+		command = strdup("printf '\\043include \"%s\"\\n'");
+		for (j = i; j < m->sources && g->inputs < m->unity; j++) {
+			if (batched[j] || !can_batch(m, j, suffix))
+				continue;
+			batched[j] = 1;
+			g->inputs++;
+			g->input = realloc(g->input, g->inputs * sizeof(char *));
+			g->input[g->inputs - 1] = module_path(p, m->source[j].name);
+			command = realloc(command, strlen(command) +
+					  strlen(m->source[j].name) + 2);
+			strcat(command, " ");
+			strcat(command, m->source[j].name);
+			free(m->source[j].name);
+		}
+		g->command = realloc(command, strlen(command) + 7);
+		strcat(g->command, " > $@");
+
+		m->generators++;
+		m->generator = realloc(m->generator,
+				       m->generators * sizeof(struct generator *));
+		m->generator[m->generators - 1] = g;
+
+		out[n].name = malloc(strlen(m->name) + 32);
+		sprintf(out[n].name, "%s_unity_%d%s", m->name, batches++, suffix);
+		out[n++].gen = g;
+	}
+
+	/* system builds generate the batches elsewhere */
+	if (batches && !has_flag(&m->include, "$(LOCAL_PATH)"))
+		insert_flag(p, &m->include, m->include.nr_flags, "$(LOCAL_PATH)");
+
+	free(batched);
+	free(m->source);
+	m->source = out;
+	m->sources = n;
+	/* it pointed at the names we just freed */
+	strset_free(&m->source_set);
+}
+
+static void add_module(struct project *p, struct module *m)
+{
+	struct module *instrumented;
+
+	apply_profile(p, m);
+	scan_includes(&p->ctx->file_cache, m, p->dir, p->scan_includes);
+	apply_unity(p, m);
+	apply_arm_neon(m);
+	apply_export_headers(p, m);
+	apply_export_symbols(p, m);
+	apply_link_startup(p, m);
+	instrumented = apply_pgo(p, m);
+	if (p->canonical_flags) {
+		canonicalize_module(m);
+		if (instrumented)
+			canonicalize_module(instrumented);
+	}
+
+	append_module(p, m);
+	if (instrumented)
+		append_module(p, instrumented);
+}
+
+static void add_subdir(struct project *p, char *name)
+{
+	p->subdirs++;
+	p->subdir = realloc(p->subdir, p->subdirs * sizeof(struct subdir));
+	p->subdir[p->subdirs - 1].name = name;
+	p->subdir[p->subdirs - 1].project = NULL;
+}
+
+/* remember path, whether it can be read or not, for --watch */
+static void add_input(struct androgenizer *ctx, const char *path)
+{
+	ctx->inputs++;
+	ctx->input = realloc(ctx->input, ctx->inputs * sizeof(char *));
+	ctx->input[ctx->inputs - 1] = strdup(path);
+}
+
+/*
+ * Read an arguments file: one androgenizer argument per line, exactly as
+ * the shell would have passed it.  Empty lines are ignored.
+ */
+static char **read_args_file(const char *path, int *argc)
+{
+	FILE *f;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	char **argv;
+
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	*argc = 0;
+	argv = NULL;
+
+	while ((len = getline(&line, &size, f)) != -1) {
+		if (len && line[len - 1] == '\n')
+			line[--len] = 0;
+		if (!len)
+			continue;
+		(*argc)++;
+		argv = realloc(argv, *argc * sizeof(char *));
+		argv[*argc - 1] = strdup(line);
+	}
+	free(line);
+	fclose(f);
+
+	/* an empty file still isn't a missing one */
+	if (!argv)
+		argv = malloc(sizeof(char *));
+
+	return argv;
+}
+
+static void free_args(char **argv, int argc)
+{
+	int i;
+
+	for (i = 0; i < argc; i++)
+		free(argv[i]);
+	free(argv);
+}
+
+/* subdirectories nested deeper than this are assumed to be a loop */
+#define MAX_AGGREGATE_DEPTH 32
+
+/*
+ * Instead of -including the Android.mk of each -:SUBDIR, parse the
+ * arguments that would have generated it and keep the resulting project,
+ * so emit_file can flatten the whole tree into a single Android.mk.
+ * Subdirectory names are relative to the project top, which is expected
+ * to be the current working directory.
+ */
+static void aggregate_subdirs(struct project *p, const char *argsfile)
+{
+	struct androgenizer *ctx = p->ctx;
+	struct subdir *s;
+	char *path;
+	char **argv;
+	int argc, i;
+
+	if (++ctx->aggregate_depth > MAX_AGGREGATE_DEPTH) {
+		die(ctx, "-:AGGREGATE subdirectories nest too deeply, is there a loop?");
+		goto out;
+	}
+
+	for (i = 0; i < p->subdirs; i++) {
+		s = &p->subdir[i];
+
+		path = malloc(strlen(s->name) + strlen(argsfile) + 2);
+		sprintf(path, "%s/%s", s->name, argsfile);
+
+		add_input(ctx, path);
+		argv = read_args_file(path, &argc);
+		if (!argv) {
+			fprintf(stderr,
+				"androgenizer: Warning: Can't read '%s', -including subdirectory '%s' instead.\n",
+				path, s->name);
+			free(path);
+			continue;
+		}
+
+		ctx->subdir = s->name;
+		s->project = options_parse(ctx, argc, argv);
+		ctx->subdir = NULL;
+		free_args(argv, argc);
+		free(path);
+		if (ctx->error)
+			break;
+
+		/* a subdirectory asking for -:AGGREGATE itself is already done */
+		if (s->project && !s->project->aggregate)
+			aggregate_subdirs(s->project, argsfile);
+		if (ctx->error)
+			break;
+	}
+out:
+	/* on errors too, or the next parse on ctx would think it's nested */
+	ctx->aggregate_depth--;
+}
+
+/* -:MERGE_ABI takes pairs of an architecture and an arguments file */
+static void add_abi(struct androgenizer *ctx, struct project *p, char *arg,
+		    int mode_args)
+{
+	struct abi *abi;
+	int i;
+
+	if (mode_args % 2 == 0) {
+		p->abi[p->abis - 1].args = arg;
+		return;
+	}
+
+	p->abis++;
+	p->abi = realloc(p->abi, p->abis * sizeof(struct abi));
+	abi = &p->abi[p->abis - 1];
+	abi->arch = arch_from_name(arg);
+	abi->args = NULL;
+	if (abi->arch == ARCHES) {
+		die(ctx, "-:MERGE_ABI must be followed by pairs of an architecture (arm, arm64, x86 or x86_64) and an arguments file");
+		return;
+	}
+	for (i = 0; i < p->abis - 1; i++) {
+		if (p->abi[i].arch == abi->arch) {
+			die(ctx, "-:MERGE_ABI lists the same architecture twice");
+			return;
+		}
+	}
+	free(arg);
+}
+
+/*
+ * Parse each ABI's arguments, as written for its own configure run, and
+ * add the modules merged from all of them to p.  Like -:AGGREGATE
+ * subdirectories, they're never streamed or -:AUTO_LINKed on their own.
+ */
+static void merge_abi_projects(struct project *p)
+{
+	struct androgenizer *ctx = p->ctx;
+	struct project *projects[ARCHES];
+	enum arch arches[ARCHES];
+	struct module *merged = NULL, *m;
+	char **argv;
+	int argc, i, count = 0, modules = 0;
+
+	if (!p->abi[p->abis - 1].args) {
+		die(ctx, "-:MERGE_ABI must be followed by pairs of an architecture (arm, arm64, x86 or x86_64) and an arguments file");
+		return;
+	}
+
+	if (++ctx->aggregate_depth > MAX_AGGREGATE_DEPTH) {
+		die(ctx, "-:MERGE_ABI arguments nest too deeply, is there a loop?");
+		ctx->aggregate_depth--;
+		return;
+	}
+	for (i = 0; i < p->abis; i++) {
+		add_input(ctx, p->abi[i].args);
+		argv = read_args_file(p->abi[i].args, &argc);
+		if (!argv) {
+			die(ctx, "can't read a -:MERGE_ABI arguments file");
+			break;
+		}
+		ctx->subdir = p->dir;
+		projects[count] = options_parse(ctx, argc, argv);
+		ctx->subdir = NULL;
+		free_args(argv, argc);
+		if (ctx->error)
+			break;
+		if (!projects[count]) {
+			die(ctx, "a -:MERGE_ABI arguments file has no -:PROJECT");
+			break;
+		}
+		arches[count++] = p->abi[i].arch;
+	}
+	ctx->aggregate_depth--;
+
+	if (!ctx->error)
+		merged = merge_abis(ctx, projects, arches, count, &modules);
+	for (i = 0; i < modules; i++) {
+		m = malloc(sizeof(struct module));
+		*m = merged[i];
+		append_module(p, m);
+	}
+	if (modules)
+		free(merged);
+	for (i = 0; i < count; i++)
+		cleanup_project(projects[i]);
+}
+
+static enum mode get_mode(char *arg)
+{
+	int i;
+	int outval = MODE_UNDEFINED;
+	int len = strlen(arg);
+
+	if (len < 3)
+		return MODE_UNDEFINED;
+	if ((arg[0] != '-') || (arg[1] != ':'))
+		return MODE_UNDEFINED;
+
+	for  (i = 0; opstrings[i].str != NULL; i++)
+		if (strcmp(opstrings[i].str, arg) == 0)
+			outval = opstrings[i].mode;
+
+	return outval;
+}
+
+static enum module_type module_type_from_mode(enum mode mode)
+{
+	switch (mode) {
+	case MODE_SHARED:
+		return MODULE_SHARED_LIBRARY;
+	case MODE_STATIC:
+		return MODULE_STATIC_LIBRARY;
+	case MODE_EXECUTABLE:
+		return MODULE_EXECUTABLE;
+	case MODE_HOST_SHARED:
+		return MODULE_HOST_SHARED_LIBRARY;
+	case MODE_HOST_STATIC:
+		return MODULE_HOST_STATIC_LIBRARY;
+	case MODE_HOST_EXECUTABLE:
+		return MODULE_HOST_EXECUTABLE;
+	default:
+		fprintf(stderr, "Unknown mode %d passed to '%s'.\n", mode, __func__);
+		abort();
+	}
+}
+
+/* -:PGO takes a keyword, then an optional argument for it */
+static void set_pgo(struct androgenizer *ctx, struct module *m, char *arg)
+{
+	if (strcmp(arg, "generate") == 0) {
+		ctx->pgo_keyword = "generate";
+		m->pgo_generate = 1;
+	} else if (strcmp(arg, "use") == 0) {
+		ctx->pgo_keyword = "use";
+		m->pgo_use = 1;
+	} else if (!ctx->pgo_keyword) {
+		die(ctx, "-:PGO must be followed by generate or use");
+		return;
+	} else if (strcmp(ctx->pgo_keyword, "generate") == 0) {
+		free(m->pgo_suffix);
+		m->pgo_suffix = arg;
+		arg = NULL;
+	} else {
+		free(m->pgo_profile);
+		m->pgo_profile = arg;
+		arg = NULL;
+	}
+	if (!arg)
+		ctx->pgo_keyword = NULL;
+	free(arg);
+}
+
+/* what can only be checked once the module is done */
+static int module_complete(struct androgenizer *ctx, struct module *m)
+{
+	if (m->pgo_use && !m->pgo_profile) {
+		die(ctx, "-:PGO use must be followed by a profile");
+		return 0;
+	}
+	return 1;
+}
+
+static enum arch arch_from_mode(enum mode mode)
+{
+	switch (mode) {
+	case MODE_SOURCES_arm:
+	case MODE_CFLAGS_arm:
+		return ARCH_ARM;
+	case MODE_SOURCES_arm64:
+	case MODE_CFLAGS_arm64:
+		return ARCH_ARM64;
+	case MODE_SOURCES_x86:
+	case MODE_CFLAGS_x86:
+		return ARCH_X86;
+	case MODE_SOURCES_x86_64:
+	case MODE_CFLAGS_x86_64:
+		return ARCH_X86_64;
+	default:
+		fprintf(stderr, "Unknown mode %d passed to '%s'.\n", mode, __func__);
+		abort();
+	}
+}
+
+/* options that take no arguments act as soon as they're seen */
+static void set_switch(struct androgenizer *ctx, struct project *p,
+		       struct module *m, enum mode mode)
+{
+	switch (mode) {
+	case MODE_PRUNE_INCLUDES:
+		if (!p) {
+			die(ctx, "a -:PROJECT must be declared before -:PRUNE_INCLUDES");
+			break;
+		}
+		p->prune_includes = 1;
+		break;
+	case MODE_CANONICAL_FLAGS:
+		if (!p) {
+			die(ctx, "a -:PROJECT must be declared before -:CANONICAL_FLAGS");
+			break;
+		}
+		p->canonical_flags = 1;
+		break;
+	case MODE_RELOCATABLE:
+		if (!p) {
+			die(ctx, "a -:PROJECT must be declared before -:RELOCATABLE");
+			break;
+		}
+		p->relocatable = 1;
+		break;
+	case MODE_WARN_DUPLICATES:
+		if (!p) {
+			die(ctx, "a -:PROJECT must be declared before -:WARN_DUPLICATES");
+			break;
+		}
+		p->warn_duplicates = 1;
+		break;
+	case MODE_AUTO_LINK:
+		if (!p) {
+			die(ctx, "a -:PROJECT must be declared before -:AUTO_LINK");
+			break;
+		}
+		p->auto_link = 1;
+		if (!m)
+			break;
+		/* its consumer may have been written out already */
+		if (p->streamed) {
+			die(ctx, "with -:STREAM, -:AUTO_LINK must come before the first module");
+			break;
+		}
+		m->auto_link = 1;
+		break;
+	case MODE_PROFILING_VARIANT:
+		if (!p) {
+			die(ctx, "a -:PROJECT must be declared before -:PROFILING_VARIANT");
+			break;
+		}
+		if (!p->profiling_suffix)
+			p->profiling_suffix = strdup("_profiling");
+		break;
+	case MODE_STREAM:
+		if (!p) {
+			die(ctx, "a -:PROJECT must be declared before -:STREAM");
+			break;
+		}
+		p->stream = 1;
+		break;
+	case MODE_COMPACT_SOURCES:
+		if (!m) {
+			die(ctx, "a module type must be declared before -:COMPACT_SOURCES");
+			break;
+		}
+		m->compact_sources = 1;
+		break;
+	case MODE_EXPORT_HEADERS:
+		if (!m) {
+			die(ctx, "a module type must be declared before -:EXPORT_HEADERS");
+			break;
+		}
+		m->export_headers = 1;
+		break;
+	case MODE_EXPORT_SYMBOLS:
+		/* takes an optional allowlist, handled like other arguments */
+		if (!m) {
+			die(ctx, "a module type must be declared before -:EXPORT_SYMBOLS");
+			break;
+		}
+		if (m->mtype != MODULE_SHARED_LIBRARY &&
+		    m->mtype != MODULE_HOST_SHARED_LIBRARY) {
+			die(ctx, "-:EXPORT_SYMBOLS only applies to shared libraries");
+			break;
+		}
+		m->export_only = 1;
+		break;
+	case MODE_LINK_STARTUP:
+		if (!m) {
+			die(ctx, "a module type must be declared before -:LINK_STARTUP");
+			break;
+		}
+		if (m->mtype != MODULE_SHARED_LIBRARY &&
+		    m->mtype != MODULE_HOST_SHARED_LIBRARY) {
+			die(ctx, "-:LINK_STARTUP only applies to shared libraries");
+			break;
+		}
+		m->link_startup = LINK_NOW;
+		break;
+	default:
+		break;
+	}
+}
+
+static enum build_type guess_build_type(struct androgenizer *ctx)
+{
+	const char *android_build_top = getenv("ANDROID_BUILD_TOP");
+
+	if (ctx->build == ANDROGENIZER_BUILD_NDK)
+		return BUILD_NDK;
+	if (ctx->build == ANDROGENIZER_BUILD_SYSTEM)
+		return BUILD_EXTERNAL;
+
+	if (android_build_top && strlen(android_build_top) > 0)
+		return BUILD_EXTERNAL;
+
+	return BUILD_NDK;
+}
+
+/*
+ * Parse androgenizer arguments, without the program name.  Returns NULL
+ * both when there was nothing to parse and on errors, ctx->error tells
+ * them apart.
+ */
+struct project *options_parse(struct androgenizer *ctx, int argc, char **args)
+{
+	enum mode mode = MODE_UNDEFINED;
+	char *arg;
+	int i, skip = 0, mode_args = 0;
+	enum build_type bt;
+	struct project *p = NULL;
+	struct module *m = NULL;
+
+	bt = guess_build_type(ctx);
+
+	if (argc < 1) {
+/* print help! */
+		return NULL;
+	}
+	for (i = 0; i < argc; i++) {
+		enum mode nm;
+		nm = get_mode(args[i]);
+		if (mode != MODE_PASSTHROUGH && mode != MODE_GENERATOR)
+			arg = add_slashes(args[i]);
+		else
+			arg = strdup(args[i]);
+
+		if (nm != MODE_UNDEFINED) {
+			free(arg);
+			skip = 0;
+			mode = nm;
+			mode_args = 0;
+			set_switch(ctx, p, m, mode);
+			if (ctx->error)
+				goto fail;
+			if (mode == MODE_END && p && m) {
+				if (!module_complete(ctx, m))
+					goto fail;
+				add_module(p, m);
+				m = NULL;
+			}
+			continue;
+		}
+
+		if (skip) {
+			skip = 0;
+			free(arg);
+			continue;
+		}
+
+		mode_args++;
+
+		switch (mode) {
+		case MODE_UNDEFINED:
+			die(ctx, "Androgenizer arguments must start with a valid -: switch, like -:PROJECT.");
+			break;
+		case MODE_PROJECT:
+			p = new_project(ctx, arg, SCRIPT_SUBDIRECTORY, bt);
+			break;
+		case MODE_SUBDIR:
+			if (!p) {
+				die(ctx, "-:PROJECT must come before -:SUBDIR");
+				break;
+			}
+			add_subdir(p, arg);
+			break;
+		case MODE_SHARED:
+		case MODE_STATIC:
+		case MODE_EXECUTABLE:
+		case MODE_HOST_SHARED:
+		case MODE_HOST_STATIC:
+		case MODE_HOST_EXECUTABLE:
+			if (!p) {
+				die(ctx, "-:PROJECT must come before a module type");
+				break;
+			}
+			if (m && !module_complete(ctx, m))
+				break;
+			if (m)
+				add_module(p, m);
+			m = new_module(arg, module_type_from_mode(mode));
+			m->profile = p->profile;
+			break;
+		case MODE_SOURCES:
+			if (!m) {
+				die(ctx, "a module type must be declared before adding -:SOURCES");
+				break;
+			}
+			add_source(p, m, arg, NULL);
+			break;
+		case MODE_UNITY:
+			if (!m) {
+				die(ctx, "a module type must be declared before -:UNITY");
+				break;
+			}
+			m->unity = atoi(arg);
+			if (m->unity < 1) {
+				die(ctx, "-:UNITY must be followed by the number of sources per batch");
+				break;
+			}
+			free(arg);
+			break;
+		case MODE_UNITY_EXCLUDE:
+			if (!m) {
+				die(ctx, "a module type must be declared before -:UNITY_EXCLUDE");
+				break;
+			}
+			m->unity_excludes++;
+			m->unity_exclude = realloc(m->unity_exclude,
+						   m->unity_excludes * sizeof(char *));
+			m->unity_exclude[m->unity_excludes - 1] = arg;
+			break;
+		case MODE_GENERATED:
+			if (!m) {
+				die(ctx, "a module type must be declared before adding -:GENERATED sources");
+				break;
+			}
+			if (mode_args == 1) {
+				if (!add_generated(m, arg))
+					die(ctx, "-:GENERATED output is already a source of the module");
+			} else
+				add_generator_input(p, m, arg);
+			break;
+		case MODE_GENERATOR:
+			if (!m || !m->generators) {
+				die(ctx, "-:GENERATED must come before -:GENERATOR");
+				break;
+			}
+			add_generator_command(m, arg);
 			break;
 		case MODE_LDFLAGS:
-			if (!m)
-				die("a module type must be declared before adding -:LDFLAGS");
-			skip = add_ldflag(m, arg, p->btype);
+			if (!m) {
+				die(ctx, "a module type must be declared before adding -:LDFLAGS");
+				break;
+			}
+			skip = add_ldflag(p, m, arg);
+			break;
+		case MODE_SOURCES_arm:
+		case MODE_SOURCES_arm64:
+		case MODE_SOURCES_x86:
+		case MODE_SOURCES_x86_64:
+			if (!m) {
+				die(ctx, "a module type must be declared before adding -:SOURCES_<arch>");
+				break;
+			}
+			add_arch_source(p, m, arch_from_mode(mode), arg);
+			break;
+		case MODE_CFLAGS_arm:
+		case MODE_CFLAGS_arm64:
+		case MODE_CFLAGS_x86:
+		case MODE_CFLAGS_x86_64:
+			if (!m) {
+				die(ctx, "a module type must be declared before adding -:CFLAGS_<arch>");
+				break;
+			}
+			add_arch_cflag(p, m, arch_from_mode(mode), arg);
 			break;
 		case MODE_CFLAGS:
-			if (!p || !m)
-				die("a module type must be declared before adding -:CFLAGS");
+			if (!p || !m) {
+				die(ctx, "a module type must be declared before adding -:CFLAGS");
+				break;
+			}
 			add_cflag(p, m, arg);
 			break;
 		case MODE_CPPFLAGS:
-			if (!p || !m)
-				die("a module type must be declared before adding -:CPPFLAGS");
+			if (!p || !m) {
+				die(ctx, "a module type must be declared before adding -:CPPFLAGS");
+				break;
+			}
 			add_cppflag(p, m, arg);
 			break;
 		case MODE_CXXFLAGS:
-			if (!p || !m)
-				die("a module type must be declared before adding -:CXXFLAGS");
+			if (!p || !m) {
+				die(ctx, "a module type must be declared before adding -:CXXFLAGS");
+				break;
+			}
 			add_cxxflag(p, m, arg);
 			break;
 		case MODE_TAGS:
-			if (!m)
-				die("a module type must be declared before setting -:TAGS");
+			if (!m) {
+				die(ctx, "a module type must be declared before setting -:TAGS");
+				break;
+			}
 			add_tag(m, arg);
 			break;
 		case MODE_HEADER_TARGET:
-			if (!m)
-				die("a module type must be declared before setting a -:HEADER_TARGET");
+			if (!m) {
+				die(ctx, "a module type must be declared before setting a -:HEADER_TARGET");
+				break;
+			}
 			if (m->header_target)
 				free(m->header_target);
 			m->header_target = arg;
 			break;
 		case MODE_HEADERS:
-			if (!m)
-				die("a module type must be declared before adding -:HEADERS");
-			add_header(m, arg);
+			if (!m) {
+				die(ctx, "a module type must be declared before adding -:HEADERS");
+				break;
+			}
+			add_header(p, m, arg);
+			break;
+		case MODE_LINK_STARTUP:
+			if (mode_args <= 2 && strcmp(arg, "pack") == 0) {
+				m->pack_relocations = 1;
+			} else if (mode_args == 1 && (strcmp(arg, "now") == 0 ||
+						      strcmp(arg, "lazy") == 0)) {
+				m->link_startup = strcmp(arg, "now") == 0 ?
+						  LINK_NOW : LINK_LAZY;
+			} else {
+				die(ctx, "-:LINK_STARTUP can only be followed by now or lazy, and pack");
+				break;
+			}
+			free(arg);
+			break;
+		case MODE_EXPORT_SYMBOLS:
+			m->export_symbols++;
+			m->export_symbol = realloc(m->export_symbol,
+						   m->export_symbols * sizeof(char *));
+			m->export_symbol[m->export_symbols - 1] = arg;
 			break;
 		case MODE_PASSTHROUGH:
-			if (!m)
-				die("a module type must be declared before a -:PASSTHROUGH");
+			if (!m) {
+				die(ctx, "a module type must be declared before a -:PASSTHROUGH");
+				break;
+			}
 			add_passthrough(m, arg);
 			break;
 		case MODE_REL_TOP:
-			if (!p)
-				die("a -:PROJECT must be declared before -:REL_TOP");
+			if (!p) {
+				die(ctx, "a -:PROJECT must be declared before -:REL_TOP");
+				break;
+			}
 			set_rel_top(p, arg);
 			free(arg);
 			break;
 		case MODE_ABS_TOP:
-			if (!p)
-				die("a -:PROJECT must be declared before -:ABS_TOP");
+			if (!p) {
+				die(ctx, "a -:PROJECT must be declared before -:ABS_TOP");
+				break;
+			}
 			set_abs_top(p, arg);
 			free(arg);
 			break;
 		case MODE_LIBFILTER_STATIC:
-			if (!m)
-				die("a module type must be declared before adding libfilters");
+			if (!m) {
+				die(ctx, "a module type must be declared before adding libfilters");
+				break;
+			}
 			add_libfilter(m, arg, LIBRARY_STATIC);
 			break;
 		case MODE_LIBFILTER_WHOLE:
-			if (!m)
-				die("a module type must be declared before adding libfilters");
+			if (!m) {
+				die(ctx, "a module type must be declared before adding libfilters");
+				break;
+			}
 			add_libfilter(m, arg, LIBRARY_WHOLE_STATIC);
 			break;
+		case MODE_SCAN_INCLUDES:
+			if (!p) {
+				die(ctx, "a -:PROJECT must be declared before -:SCAN_INCLUDES");
+				break;
+			}
+			p->scan_includes = scan_mode_from_name(arg);
+			if (p->scan_includes == SCAN_NONE) {
+				die(ctx, "-:SCAN_INCLUDES must be one of reorder or drop");
+				break;
+			}
+			free(arg);
+			break;
+		case MODE_PROFILE:
+			if (!p) {
+				die(ctx, "a -:PROJECT must be declared before -:PROFILE");
+				break;
+			}
+			if (profile_from_name(arg) == PROFILE_NONE) {
+				die(ctx, "-:PROFILE must be one of release, size or debug");
+				break;
+			}
+			if (m)
+				m->profile = profile_from_name(arg);
+			else
+				p->profile = profile_from_name(arg);
+			free(arg);
+			break;
+		case MODE_PGO:
+			if (!m) {
+				die(ctx, "a module type must be declared before -:PGO");
+				break;
+			}
+			set_pgo(ctx, m, arg);
+			break;
+		case MODE_PROFILING_VARIANT:
+			if (mode_args > 2) {
+				die(ctx, "-:PROFILING_VARIANT takes at most instrument and a suffix");
+				break;
+			}
+			if (strcmp(arg, "instrument") == 0) {
+				p->profiling_instrument = 1;
+				free(arg);
+				break;
+			}
+			free(p->profiling_suffix);
+			p->profiling_suffix = arg;
+			break;
+		case MODE_PREBUILT_CACHE:
+			if (!p) {
+				die(ctx, "a -:PROJECT must be declared before -:PREBUILT_CACHE");
+				break;
+			}
+			if (mode_args > 2) {
+				die(ctx, "-:PREBUILT_CACHE takes a directory and a toolchain id");
+				break;
+			}
+			if (mode_args == 2) {
+				free(p->toolchain_id);
+				p->toolchain_id = arg;
+				break;
+			}
+			if (arg[0] != '/') {
+				die(ctx, "-:PREBUILT_CACHE needs an absolute directory, make and androgenizer don't run in the same one");
+				break;
+			}
+			free(p->prebuilt_cache);
+			p->prebuilt_cache = arg;
+			break;
+		case MODE_AGGREGATE:
+			if (!p) {
+				die(ctx, "a -:PROJECT must be declared before -:AGGREGATE");
+				break;
+			}
+			free(p->aggregate);
+			p->aggregate = arg;
+			break;
+		case MODE_MERGE_ABI:
+			if (!p) {
+				die(ctx, "a -:PROJECT must be declared before -:MERGE_ABI");
+				break;
+			}
+			add_abi(ctx, p, arg, mode_args);
+			break;
+		case MODE_COMPACT_SOURCES:
+		case MODE_EXPORT_HEADERS:
+		case MODE_WARN_DUPLICATES:
+		case MODE_STREAM:
+		case MODE_AUTO_LINK:
+		case MODE_RELOCATABLE:
+		case MODE_PRUNE_INCLUDES:
+		case MODE_CANONICAL_FLAGS:
 		case MODE_END:
 			break;
 		}
+
+		/* whatever failed didn't take arg */
+		if (ctx->error) {
+			free(arg);
+			goto fail;
+		}
 	}
+	ctx->cflag_space = NULL;
+	ctx->pgo_keyword = NULL;
+	if (p && m && !module_complete(ctx, m))
+		goto fail;
 	if (p && m)
 		add_module(p, m);
+	if (p && p->abis)
+		merge_abi_projects(p);
+	if (p && p->aggregate)
+		aggregate_subdirs(p, p->aggregate);
+	if (p && p->profiling_suffix && !ctx->error && !ctx->aggregate_depth)
+		profiling_variants(p);
+	if (p && p->auto_link && !ctx->error && !ctx->aggregate_depth)
+		auto_link(p);
+	if (p && p->prebuilt_cache && !ctx->error && !ctx->aggregate_depth) {
+		if (p->toolchain_id)
+			prebuilt_cache(p);
+		else
+			die(ctx, "-:PREBUILT_CACHE takes a directory and a toolchain id");
+	}
+	if (ctx->error) {
+		cleanup_project(p);
+		return NULL;
+	}
+	return p;
+
+fail:
+	ctx->cflag_space = NULL;
+	ctx->pgo_keyword = NULL;
+	if (m) {
+		cleanup_module(m);
+		free(m);
+	}
+	if (p)
+		cleanup_project(p);
+	return NULL;
+}
+
+struct project *options_parse_file(struct androgenizer *ctx, const char *path)
+{
+	struct project *p;
+	char **argv;
+	int argc;
+
+	add_input(ctx, path);
+	argv = read_args_file(path, &argc);
+	if (!argv) {
+		die(ctx, "can't read the arguments file");
+		return NULL;
+	}
+
+	p = options_parse(ctx, argc, argv);
+	free_args(argv, argc);
 	return p;
 }
@@ -20,6 +20,9 @@
 
 #include "common.h"
 
-struct project *options_parse(int argc, char **argv);
+struct project *options_parse(struct androgenizer *ctx, int argc, char **argv);
+
+/* the same, with arguments read from a file as for -:AGGREGATE */
+struct project *options_parse_file(struct androgenizer *ctx, const char *path);
 
 #endif /* __OPTIONS_H__ */
@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <string.h>
+#include "common.h"
+#include "profile.h"
+
+#define RELEASE		(1 << PROFILE_RELEASE)
+#define SIZE		(1 << PROFILE_SIZE)
+#define DEBUG		(1 << PROFILE_DEBUG)
+#define OPTIMIZED	(RELEASE | SIZE)
+
+#define DEVICE_LINKED	((1 << MODULE_SHARED_LIBRARY) | \
+			 (1 << MODULE_EXECUTABLE))
+#define HOST_LINKED	((1 << MODULE_HOST_SHARED_LIBRARY) | \
+			 (1 << MODULE_HOST_EXECUTABLE))
+#define STATIC		((1 << MODULE_STATIC_LIBRARY) | \
+			 (1 << MODULE_HOST_STATIC_LIBRARY))
+#define LINKED		(DEVICE_LINKED | HOST_LINKED)
+#define ALL		(LINKED | STATIC)
+
+#define NDK		(1 << BUILD_NDK)
+#define SYSTEM		(1 << BUILD_EXTERNAL)
+#define BOTH		(NDK | SYSTEM)
+
+/*
+ * Everything a profile adds to a module, in order.  Static libraries
+ * don't get -flto: their objects would only be usable by consumers that
+ * are themselves linked with LTO.  --icf needs gold or lld, which we can
+ * only count on for the target.  ndk-build strips by LOCAL_STRIP_MODE,
+ * and ignores the system build's LOCAL_STRIP_MODULE.  Either way the debug
+ * info is split off rather than lost: the unstripped copy stays under
+ * symbols/, or obj/local/<abi>/ for the NDK.
+ */
+const struct profile_directive profile_directives[] = {
+	{ RELEASE,	ALL,		BOTH,	PROFILE_CFLAG,	"-O2" },
+	{ SIZE,		ALL,		BOTH,	PROFILE_CFLAG,	"-Os" },
+	{ DEBUG,	ALL,		BOTH,	PROFILE_CFLAG,	"-O0" },
+	{ DEBUG,	ALL,		BOTH,	PROFILE_CFLAG,	"-g" },
+	{ DEBUG,	ALL,		BOTH,	PROFILE_CFLAG,	"-fno-omit-frame-pointer" },
+	{ OPTIMIZED,	ALL,		BOTH,	PROFILE_CFLAG,	"-ffunction-sections" },
+	{ OPTIMIZED,	ALL,		BOTH,	PROFILE_CFLAG,	"-fdata-sections" },
+	{ OPTIMIZED,	LINKED,		BOTH,	PROFILE_CFLAG,	"-flto" },
+	{ OPTIMIZED,	LINKED,		BOTH,	PROFILE_LDFLAG,	"-flto" },
+	{ OPTIMIZED,	LINKED,		BOTH,	PROFILE_LDFLAG,	"-Wl,--gc-sections" },
+	{ RELEASE,	DEVICE_LINKED,	BOTH,	PROFILE_LDFLAG,	"-Wl,--icf=safe" },
+	{ SIZE,		DEVICE_LINKED,	BOTH,	PROFILE_LDFLAG,	"-Wl,--icf=all" },
+	{ OPTIMIZED,	DEVICE_LINKED,	SYSTEM,	PROFILE_PASSTHROUGH, "LOCAL_STRIP_MODULE := true" },
+	{ DEBUG,	DEVICE_LINKED,	SYSTEM,	PROFILE_PASSTHROUGH, "LOCAL_STRIP_MODULE := false" },
+	{ OPTIMIZED,	DEVICE_LINKED,	NDK,	PROFILE_PASSTHROUGH, "LOCAL_STRIP_MODE := --strip-unneeded" },
+	{ DEBUG,	DEVICE_LINKED,	NDK,	PROFILE_PASSTHROUGH, "LOCAL_STRIP_MODE := none" },
+	{ 0, 0, 0, 0, NULL }
+};
+
+static const char *profile_names[] = {
+	[PROFILE_RELEASE] = "release",
+	[PROFILE_SIZE] = "size",
+	[PROFILE_DEBUG] = "debug",
+};
+
+enum profile profile_from_name(const char *name)
+{
+	int i;
+
+	for (i = PROFILE_RELEASE; i <= PROFILE_DEBUG; i++)
+		if (strcmp(name, profile_names[i]) == 0)
+			return i;
+
+	return PROFILE_NONE;
+}
+
+int profile_applies(const struct profile_directive *pd, enum profile prof,
+		    enum module_type mtype, enum build_type btype)
+{
+	return (pd->profiles & (1 << prof)) && (pd->modules & (1 << mtype)) &&
+	       (pd->builds & (1 << btype));
+}
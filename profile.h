@@ -0,0 +1,44 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include "common.h"
+
+enum profile_kind {
+	PROFILE_CFLAG,
+	PROFILE_LDFLAG,
+	PROFILE_PASSTHROUGH
+};
+
+struct profile_directive {
+	int profiles;	/* mask of 1 << enum profile */
+	int modules;	/* mask of 1 << enum module_type */
+	int builds;	/* mask of 1 << enum build_type */
+	enum profile_kind kind;
+	const char *str;
+};
+
+enum profile profile_from_name(const char *name);
+
+int profile_applies(const struct profile_directive *pd, enum profile prof,
+		    enum module_type mtype, enum build_type btype);
+
+extern const struct profile_directive profile_directives[];
+
+#endif /* __PROFILE_H__ */
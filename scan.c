@@ -0,0 +1,358 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "hash.h"
+#include "scan.h"
+
+/*
+ * A lightweight #include scanner: no preprocessing, every #include in a
+ * file counts whatever #if it's under.  That only ever makes us think
+ * more include directories are used than really are, which is the safe
+ * direction to be wrong in.
+ */
+
+struct scan {
+	struct strmap *file_cache;
+	struct module *m;
+	const char *dir;	/* relative paths are under, or NULL */
+	int *used;		/* per m->include entry */
+	int computed;		/* saw #include MACRO */
+	int unreadable;		/* sources we couldn't open */
+	char **queue;
+	int queued;
+	struct strmap seen;
+};
+
+/* whether each file exists, the cache is shared by every module we scan */
+static int file_exists = 1, file_missing;
+
+static int is_file(struct scan *s, const char *path)
+{
+	struct stat st;
+	int *cached = strmap_get(s->file_cache, path);
+
+	if (!cached) {
+		cached = (stat(path, &st) == 0 && S_ISREG(st.st_mode)) ?
+			 &file_exists : &file_missing;
+		strmap_put(s->file_cache, path, cached);
+	}
+	return *cached;
+}
+
+static char *join(const char *dir, int dir_len, const char *name)
+{
+	char *out = malloc(dir_len + strlen(name) + 2);
+
+	if (dir_len)
+		sprintf(out, "%.*s/%s", dir_len, dir, name);
+	else
+		strcpy(out, name);
+	return out;
+}
+
+static const char *trim(const char *path)
+{
+	while (*path && isblank(*path))
+		path++;
+	if (path[0] == '/' && path[1] == '/')
+		path++;
+	return path;
+}
+
+static char *in_dir(struct scan *s, const char *path)
+{
+	if (!s->dir || path[0] == '/')
+		return strdup(path);
+	return join(s->dir, strlen(s->dir), path);
+}
+
+/* files are only scanned once, under their canonical name */
+static void queue_file(struct scan *s, const char *path)
+{
+	char real[PATH_MAX];
+
+	if (!realpath(path, real) || strmap_get(&s->seen, real))
+		return;
+
+	strmap_put(&s->seen, real, &file_exists);
+	s->queued++;
+	s->queue = realloc(s->queue, s->queued * sizeof(char *));
+	s->queue[s->queued - 1] = strdup(real);
+}
+
+static void resolve(struct scan *s, const char *file, const char *name,
+		    int quoted)
+{
+	struct flag_array *inc = &s->m->include;
+	const char *slash;
+	char *dir;
+	char *candidate;
+	int i, found = 0;
+
+	if (quoted) {
+		slash = strrchr(file, '/');
+		candidate = join(file, slash ? slash - file : 0, name);
+		found = is_file(s, candidate);
+		if (found)
+			queue_file(s, candidate);
+		free(candidate);
+		if (found)
+			return;
+	}
+
+	/* every directory that has it counts as used, not just the first */
+	for (i = 0; i < inc->nr_flags; i++) {
+		if (!inc->flags[i].path)
+			continue;
+		dir = in_dir(s, trim(inc->flags[i].path));
+		candidate = join(dir, strlen(dir), name);
+		if (is_file(s, candidate)) {
+			s->used[i] = 1;
+			if (!found++)
+				queue_file(s, candidate);
+		}
+		free(candidate);
+		free(dir);
+	}
+}
+
+static int skip_word(char **p, const char *word)
+{
+	int len = strlen(word);
+
+	if (strncmp(*p, word, len) != 0)
+		return 0;
+	*p += len;
+	return 1;
+}
+
+static void scan_file(struct scan *s, const char *path, int is_source)
+{
+	FILE *f;
+	char *line = NULL;
+	size_t size = 0;
+	char *p, *end;
+	char close;
+
+	f = fopen(path, "r");
+	if (!f) {
+		if (is_source)
+			s->unreadable++;
+		return;
+	}
+
+	while (getline(&line, &size, f) != -1) {
+		p = line;
+		while (isblank(*p))
+			p++;
+		if (*p++ != '#')
+			continue;
+		while (isblank(*p))
+			p++;
+		if (!skip_word(&p, "include_next") &&
+		    !skip_word(&p, "include") &&
+		    !skip_word(&p, "import"))
+			continue;
+		while (isblank(*p))
+			p++;
+
+		if (*p == '"')
+			close = '"';
+		else if (*p == '<')
+			close = '>';
+		else {
+			if (*p && *p != '\n')
+				s->computed = 1;
+			continue;
+		}
+
+		end = strchr(p + 1, close);
+		if (!end)
+			continue;
+		*end = 0;
+		resolve(s, path, p + 1, close == '"');
+	}
+	free(line);
+	fclose(f);
+}
+
+static const char *scan_modes[] = {
+	[SCAN_REORDER] = "reorder",
+	[SCAN_DROP] = "drop",
+};
+
+enum scan_mode scan_mode_from_name(const char *name)
+{
+	int i;
+
+	for (i = SCAN_REORDER; i <= SCAN_DROP; i++)
+		if (strcmp(name, scan_modes[i]) == 0)
+			return i;
+
+	return SCAN_NONE;
+}
+
+static void scan_forced(struct scan *s, struct flag_array *arr)
+{
+	char *path;
+	int i;
+
+	for (i = 0; i < arr->nr_flags; i++) {
+		if (!arr->flags[i].path ||
+		    strncmp(arr->flags[i].flag, "-include ", 9) != 0)
+			continue;
+		path = in_dir(s, trim(arr->flags[i].path));
+		if (is_file(s, path))
+			queue_file(s, path);
+		else
+			s->unreadable++;
+		free(path);
+	}
+}
+
+static void scan_source(struct scan *s, const char *name)
+{
+	char *path = in_dir(s, name);
+
+	scan_file(s, path, 1);
+	free(path);
+}
+
+/*
+ * Queue the -include files and sources of m, and follow them.  With
+ * strict, a header found but not readable counts as unreadable too.
+ */
+static void scan_module(struct scan *s, int strict)
+{
+	struct module *m = s->m;
+	int i, j;
+
+	scan_forced(s, &m->c);
+	scan_forced(s, &m->cpp);
+	scan_forced(s, &m->cxx);
+	for (i = 0; i < ARCHES; i++) {
+		scan_forced(s, &m->arch[i].c);
+		scan_forced(s, &m->arch[i].cxx);
+	}
+
+	for (i = 0; i < m->sources; i++)
+		scan_source(s, m->source[i].name);
+	for (i = 0; i < ARCHES; i++)
+		for (j = 0; j < m->arch[i].sources; j++)
+			scan_source(s, m->arch[i].source[j].name);
+	for (i = 0; i < s->queued; i++)
+		scan_file(s, s->queue[i], strict);
+}
+
+/*
+ * Follow the #includes of every source and -include file of m through its
+ * include directories, then move the directories nothing resolved to to
+ * the end (SCAN_REORDER), or drop them (SCAN_DROP).  Moving them is safe
+ * as long as we saw every header: none of them can be found there, so the
+ * first match for each stays the same.  A computed #include, or a source
+ * or -include file we couldn't read, could use anything, so then nothing
+ * is touched.  Paths are relative to dir unless it's NULL.
+ */
+void scan_includes(struct strmap *file_cache, struct module *m,
+		   const char *dir, enum scan_mode mode)
+{
+	struct scan s;
+	struct flag *sorted;
+	int i, n;
+
+	if (mode == SCAN_NONE || m->include.nr_flags == 0)
+		return;
+
+	memset(&s, 0, sizeof(s));
+	s.file_cache = file_cache;
+	s.m = m;
+	s.dir = dir;
+	s.used = calloc(m->include.nr_flags, sizeof(int));
+	scan_module(&s, 0);
+
+	if (s.computed || s.unreadable) {
+		fprintf(stderr,
+			"androgenizer: Warning: Module '%s' has %s, leaving its include directories as they are.\n",
+			m->name, s.computed ? "computed #includes" : "files that can't be read");
+		goto out;
+	}
+
+	sorted = malloc(m->include.nr_flags * sizeof(struct flag));
+	n = 0;
+	for (i = 0; i < m->include.nr_flags; i++)
+		if (s.used[i] || !m->include.flags[i].path)
+			sorted[n++] = m->include.flags[i];
+	for (i = 0; i < m->include.nr_flags; i++) {
+		if (s.used[i] || !m->include.flags[i].path)
+			continue;
+		if (mode == SCAN_REORDER) {
+			sorted[n++] = m->include.flags[i];
+			continue;
+		}
+		fprintf(stderr,
+			"androgenizer: Warning: Dropping unused include directory '%s' from module '%s'.\n",
+			m->include.flags[i].path, m->name);
+	}
+	free(m->include.flags);
+	m->include.flags = sorted;
+	m->include.nr_flags = n;
+
+out:
+	for (i = 0; i < s.queued; i++)
+		free(s.queue[i]);
+	free(s.queue);
+	free(s.used);
+	strmap_free(&s.seen);
+}
+
+/*
+ * Every header and -include file the sources of m reach, by canonical
+ * name, for -:PREBUILT_CACHE to hash.  Paths are relative to dir unless
+ * it's NULL.  Returns how many there are in *files, or -1 if there's no
+ * telling: computed #includes, or files that can't be read.
+ */
+int scan_closure(struct strmap *file_cache, struct module *m,
+		 const char *dir, char ***files)
+{
+	struct scan s;
+	int i;
+
+	memset(&s, 0, sizeof(s));
+	s.file_cache = file_cache;
+	s.m = m;
+	s.dir = dir;
+	s.used = calloc(m->include.nr_flags + 1, sizeof(int));
+	scan_module(&s, 1);
+
+	free(s.used);
+	strmap_free(&s.seen);
+	if (s.computed || s.unreadable) {
+		for (i = 0; i < s.queued; i++)
+			free(s.queue[i]);
+		free(s.queue);
+		return -1;
+	}
+	*files = s.queue;
+	return s.queued;
+}
@@ -0,0 +1,31 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+#include "common.h"
+
+enum scan_mode scan_mode_from_name(const char *name);
+
+void scan_includes(struct strmap *file_cache, struct module *m,
+		   const char *dir, enum scan_mode mode);
+
+int scan_closure(struct strmap *file_cache, struct module *m,
+		 const char *dir, char ***files);
+
+#endif /* __SCAN_H__ */
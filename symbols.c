@@ -0,0 +1,324 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "hash.h"
+#include "symbols.h"
+
+/*
+ * A lightweight declaration scanner, like the #include one: no
+ * preprocessing, just C statements at file scope.  A statement ending in
+ * ; declares a function if an identifier is directly followed by (, or an
+ * extern variable otherwise.  ALL_CAPS identifiers are taken for macros
+ * (G_BEGIN_DECLS, GST_API, G_GNUC_CONST, ...) and ignored, as are typedefs,
+ * static declarations and anything with a body.
+ */
+
+struct statement {
+	char *first;		/* first identifier that isn't a macro */
+	char *last;		/* last identifier, while it can be a name */
+	char *function;
+	char **variable;
+	int variables;
+	int is_extern;
+	int has_body;
+	int after_ident;	/* the last token was an identifier */
+	int after_attribute;	/* the last token was __attribute__ or alike */
+};
+
+static int is_macro(const char *ident, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		if (islower((unsigned char)ident[i]))
+			return 0;
+	return 1;
+}
+
+/* followed by parentheses that aren't part of the declarator */
+static const char *attributes[] = {
+	"__attribute__", "__attribute", "__declspec", "__asm__", "__asm",
+	"asm", "__typeof__", "typeof", "__extension__", NULL
+};
+
+static const char *keywords[] = {
+	"void", "char", "short", "int", "long", "float", "double", "signed",
+	"unsigned", "const", "volatile", "restrict", "__restrict", "_Bool",
+	"extern", "static", "inline", "__inline", "__inline__", "register",
+	"struct", "union", "enum", "typedef", NULL
+};
+
+static int is_one_of(const char **list, const char *ident, int len)
+{
+	int i;
+
+	for (i = 0; list[i]; i++)
+		if (strncmp(ident, list[i], len) == 0 && !list[i][len])
+			return 1;
+	return 0;
+}
+
+static void statement_reset(struct statement *s)
+{
+	int i;
+
+	free(s->first);
+	free(s->last);
+	free(s->function);
+	for (i = 0; i < s->variables; i++)
+		free(s->variable[i]);
+	free(s->variable);
+	memset(s, 0, sizeof(*s));
+}
+
+static void add_name(struct module *m, struct strset *seen, char *name)
+{
+	if (!strset_add(seen, name)) {
+		free(name);
+		return;
+	}
+	m->export_symbols++;
+	m->export_symbol = realloc(m->export_symbol,
+				   m->export_symbols * sizeof(char *));
+	m->export_symbol[m->export_symbols - 1] = name;
+}
+
+/* a declarator of an extern variable ends at , = [ or ; */
+static void end_declarator(struct statement *s)
+{
+	if (!s->is_extern || s->function || !s->last)
+		return;
+	s->variables++;
+	s->variable = realloc(s->variable, s->variables * sizeof(char *));
+	s->variable[s->variables - 1] = s->last;
+	s->last = NULL;
+}
+
+static void end_statement(struct module *m, struct strset *seen,
+			  struct statement *s)
+{
+	int i;
+
+	end_declarator(s);
+	if (s->has_body || !s->first || strcmp(s->first, "typedef") == 0 ||
+	    strcmp(s->first, "static") == 0)
+		goto out;
+
+	if (s->function) {
+		add_name(m, seen, s->function);
+		s->function = NULL;
+	}
+	for (i = 0; i < s->variables; i++) {
+		add_name(m, seen, s->variable[i]);
+		s->variable[i] = NULL;
+	}
+out:
+	statement_reset(s);
+}
+
+static char *read_all(const char *path)
+{
+	FILE *f;
+	char *buf = NULL;
+	size_t len = 0, size = 0;
+
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	do {
+		size = size ? size * 2 : 4096;
+		buf = realloc(buf, size + 1);
+		len += fread(buf + len, 1, size - len, f);
+	} while (len == size);
+	buf[len] = 0;
+	fclose(f);
+	return buf;
+}
+
+/* skips comments, literals and preprocessor lines starting at p */
+static const char *skip_noise(const char *p, int *line_start)
+{
+	const char *end;
+
+	for (;;) {
+		if (*p == '\n') {
+			*line_start = 1;
+			p++;
+		} else if (isspace((unsigned char)*p)) {
+			p++;
+		} else if (p[0] == '/' && p[1] == '*') {
+			end = strstr(p + 2, "*/");
+			p = end ? end + 2 : p + strlen(p);
+		} else if (p[0] == '/' && p[1] == '/') {
+			while (*p && *p != '\n')
+				p++;
+		} else if (*p == '#' && *line_start) {
+			while (*p && (*p != '\n' || p[-1] == '\\'))
+				p++;
+		} else {
+			*line_start = 0;
+			return p;
+		}
+	}
+}
+
+static int scan_header(struct module *m, struct strset *seen,
+		       const char *path)
+{
+	struct statement s;
+	char *buf;
+	const char *p, *start;
+	char close;
+	int depth = 0, parens = 0, line_start = 1, len;
+
+	buf = read_all(path);
+	if (!buf)
+		return 0;
+
+	memset(&s, 0, sizeof(s));
+	p = buf;
+	while (*(p = skip_noise(p, &line_start))) {
+		if (isalpha((unsigned char)*p) || *p == '_') {
+			start = p;
+			while (isalnum((unsigned char)*p) || *p == '_')
+				p++;
+			len = p - start;
+			s.after_ident = 0;
+			s.after_attribute = 0;
+			if (depth || parens || is_macro(start, len))
+				continue;
+			if (is_one_of(attributes, start, len)) {
+				s.after_attribute = 1;
+				continue;
+			}
+			if (!s.first)
+				s.first = strndup(start, len);
+			free(s.last);
+			s.last = NULL;
+			if (is_one_of(keywords, start, len)) {
+				if (len == 6 && strncmp(start, "extern", 6) == 0)
+					s.is_extern = 1;
+				continue;
+			}
+			s.last = strndup(start, len);
+			s.after_ident = 1;
+			continue;
+		}
+
+		if (*p == '"' || *p == '\'') {
+			close = *p++;
+			while (*p && *p != close)
+				p += (*p == '\\' && p[1]) ? 2 : 1;
+			if (*p)
+				p++;
+			s.after_ident = 0;
+			continue;
+		}
+
+		switch (*p++) {
+		case '(':
+			if (depth || parens || s.after_attribute) {
+				/* not part of the declarator */
+			} else if (s.after_ident && !s.function) {
+				s.function = s.last;
+				s.last = NULL;
+			} else {
+				/* like void (*hook)(void), not for us */
+				free(s.last);
+				s.last = NULL;
+			}
+			parens++;
+			break;
+		case ')':
+			if (parens)
+				parens--;
+			break;
+		case '{':
+			/* extern "C" { only wraps declarations */
+			if (!depth && s.is_extern && !s.last && !s.function) {
+				statement_reset(&s);
+				break;
+			}
+			if (!depth)
+				s.has_body = 1;
+			depth++;
+			break;
+		case '}':
+			if (depth)
+				depth--;
+			/* a function body isn't followed by ; */
+			if (!depth && s.has_body && s.function)
+				statement_reset(&s);
+			break;
+		case ';':
+			if (!depth && !parens)
+				end_statement(m, seen, &s);
+			break;
+		case ',':
+		case '=':
+		case '[':
+			if (!depth && !parens)
+				end_declarator(&s);
+			break;
+		}
+		s.after_ident = 0;
+		s.after_attribute = 0;
+	}
+	statement_reset(&s);
+	free(buf);
+	return 1;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+const char *scan_symbols(struct module *m, const char *dir)
+{
+	struct strset seen;
+	const char *unreadable = NULL;
+	char *path;
+	int i;
+
+	memset(&seen, 0, sizeof(seen));
+	for (i = 0; i < m->export_symbols; i++)
+		strset_add(&seen, m->export_symbol[i]);
+
+	for (i = 0; i < m->headers && !unreadable; i++) {
+		if (!dir || m->header[i].name[0] == '/') {
+			path = strdup(m->header[i].name);
+		} else {
+			path = malloc(strlen(dir) + strlen(m->header[i].name) + 2);
+			sprintf(path, "%s/%s", dir, m->header[i].name);
+		}
+		if (!scan_header(m, &seen, path))
+			unreadable = m->header[i].name;
+		free(path);
+	}
+
+	strset_free(&seen);
+	qsort(m->export_symbol, m->export_symbols, sizeof(char *),
+	      compare_names);
+	return unreadable;
+}
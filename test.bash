@@ -22,3 +22,324 @@ export ANDROID_BUILD_TOP=/android/build/top
 	-:LDFLAGS -no-undefined -lmust_keep_lib -pthread -version-info 1:2:3 \
 	-lmust_keep_lib_2 -Lkikkare -Rfuppare -lmust_keep_lib_3
 
+
+"$@" ./androgenizer \
+	-:PROJECT compact \
+	-:SHARED libcompact \
+	-:COMPACT_SOURCES \
+	-:SOURCES src/a.c src/b.c main.c src/c.c lib/x.c lib/y.c src/a.c \
+	-:LDFLAGS -lfoo libbar.la -lbar -lfoo \
+	-:SOURCES_arm neon/a.c neon/b.c -:CFLAGS_arm -mfpu=neon -DHAVE_NEON \
+	-:SOURCES_x86_64 x86/avx2.c -:CFLAGS_x86_64 -mavx2
+
+"$@" ./androgenizer \
+	-:PROJECT reloc \
+	-:RELOCATABLE -:REL_TOP .. -:ABS_TOP /android/build/top/reloc \
+	-:SHARED libreloc \
+	-:SOURCES reloc.c \
+	-:CFLAGS -I. -I.. -I../include -I/android/build/top/reloc/gen \
+	-Isrc -I/android/build/top/other -include ../config.h
+
+"$@" ./androgenizer \
+	-:PROJECT exported \
+	-:SHARED libexported \
+	-:EXPORT_HEADERS \
+	-:SOURCES exported.c \
+	-:HEADER_TARGET exported-1.0/exported \
+	-:HEADERS exported.h exported/a.h exported/b.h lib/exported/c.h
+
+"$@" ./androgenizer \
+	-:PROJECT merged \
+	-:MERGE_ABI \
+	arm <(printf '%s\n' -:PROJECT merged -:SHARED libmerged \
+		-:SOURCES common.c arm/neon.c -:CFLAGS -DHAVE_CONFIG_H -Iarm \
+		-:LDFLAGS -lm -lcpufeatures \
+		-:EXECUTABLE armtool -:SOURCES tool.c) \
+	x86 <(printf '%s\n' -:PROJECT merged -:SHARED libmerged \
+		-:SOURCES x86/sse.c common.c -:CFLAGS -DHAVE_CONFIG_H -Ix86 \
+		-DHAVE_SSE2 -:LDFLAGS -lm)
+
+"$@" ./androgenizer \
+	-:PROJECT profiled \
+	-:PROFILING_VARIANT _prof \
+	-:SHARED libprofiled \
+	-:SOURCES profiled.c \
+	-:CFLAGS -O2 -fomit-frame-pointer \
+	-:LDFLAGS -llog -lhelper -lexternal \
+	-:STATIC libhelper \
+	-:SOURCES helper.c
+
+"$@" ./androgenizer \
+	-:PROJECT canonical \
+	-:CANONICAL_FLAGS \
+	-:PROFILE release \
+	-:SHARED libcanonical \
+	-:SOURCES canonical.c \
+	-:CFLAGS -O0 -DFOO=1 -g -DFOO=2 -g3 -fomit-frame-pointer \
+	-fno-omit-frame-pointer -fsanitize=address -fsanitize=undefined \
+	-Wno-unused -Wunused -DFOO=1 \
+	-:CPPFLAGS -Os
+
+prebuilt=$(mktemp -d)
+printf '#include "prebuilt.h"\nint prebuilt(void) { return PREBUILT; }\n' \
+	> "$prebuilt/prebuilt.c"
+printf '#define PREBUILT 1\n' > "$prebuilt/prebuilt.h"
+(cd "$prebuilt" && "$@" "$OLDPWD/androgenizer" \
+	-:PROJECT prebuilt \
+	-:PREBUILT_CACHE /nonexistent/cache ndk-r26 \
+	-:SHARED libprebuilt \
+	-:SOURCES prebuilt.c \
+	-:LDFLAGS -llog \
+	-:STATIC libgenerated \
+	-:GENERATED generated.c)
+rm -rf "$prebuilt"
+
+exports=$(mktemp -d)
+printf '%s\n' 'int exported_f(int a, int b);' 'extern const char *exported_v;' \
+	'static inline int not_exported(void) { return 0; }' \
+	'#define NOT_EXPORTED(x) (x)' 'typedef int not_exported_t;' \
+	> "$exports/exported.h"
+printf 'int unterminated(void);\n/* no end\nint hidden(void);\n' \
+	> "$exports/unterminated.h"
+(cd "$exports" && "$@" "$OLDPWD/androgenizer" \
+	-:PROJECT symbols \
+	-:SHARED libsymbols \
+	-:SOURCES symbols.c \
+	-:HEADERS exported.h unterminated.h \
+	-:EXPORT_SYMBOLS JNI_OnLoad)
+# headers of an aggregated subdirectory are relative to it, and one that
+# can't be read is an error rather than a script hiding everything
+mkdir "$exports/sub"
+printf 'int pub(void);\n' > "$exports/sub/pub.h"
+printf '%s\n' -:PROJECT symbols -:SHARED libpub -:SOURCES pub.c \
+	-:HEADERS pub.h -:EXPORT_SYMBOLS > "$exports/sub/args"
+(cd "$exports" && "$@" "$OLDPWD/androgenizer" \
+	-:PROJECT symbols \
+	-:AGGREGATE args \
+	-:SUBDIR sub)
+(cd "$exports" && "$@" "$OLDPWD/androgenizer" \
+	-:PROJECT symbols \
+	-:SHARED libmissing \
+	-:SOURCES missing.c \
+	-:HEADERS missing.h \
+	-:EXPORT_SYMBOLS 2>&1)
+rm -rf "$exports"
+
+# --watch regenerates when the arguments file changes, seeing what's on
+# disk now rather than what was there at the first parse
+watched=$(mktemp -d)
+printf '%s\n' -:PROJECT watched -:PRUNE_INCLUDES -:SHARED libwatched \
+	-:SOURCES watched.c -:CFLAGS -Iinc > "$watched/args"
+(cd "$watched" && exec "$@" "$OLDPWD/androgenizer" --watch args Android.mk) &
+for i in $(seq 100); do
+	[ -e "$watched/Android.mk" ] && break
+	sleep 0.1
+done
+sleep 0.5
+mkdir "$watched/inc"
+printf '%s\n' -:PROJECT watched -:PRUNE_INCLUDES -:SHARED libwatched \
+	-:SOURCES watched.c -:CFLAGS -Iinc -DWATCHED > "$watched/args"
+for i in $(seq 100); do
+	grep -q WATCHED "$watched/Android.mk" && break
+	sleep 0.1
+done
+kill $!
+wait $! 2>/dev/null
+cat "$watched/Android.mk"
+rm -rf "$watched"
+
+# a parse failing in a subdirectory doesn't leave the next parse of the
+# same context nested, skipping -:PROFILING_VARIANT and alike
+reused=$(mktemp -d)
+mkdir "$reused/bad" "$reused/good"
+printf '%s\n' -:PROJECT bad -:SHARED libbad -:SOURCES bad.c -:PGO use \
+	> "$reused/bad/args"
+printf '%s\n' -:PROJECT good -:SHARED libgood -:SOURCES good.c \
+	> "$reused/good/args"
+printf '%s\n' -:PROJECT reused -:PROFILING_VARIANT -:AGGREGATE args \
+	-:SUBDIR bad > "$reused/args"
+(cd "$reused" && exec "$@" "$OLDPWD/androgenizer" --watch args Android.mk \
+	2> "$reused/errors") &
+for i in $(seq 100); do
+	grep -q Error "$reused/errors" && break
+	sleep 0.1
+done
+printf '%s\n' -:PROJECT reused -:PROFILING_VARIANT -:AGGREGATE args \
+	-:SUBDIR good > "$reused/args"
+for i in $(seq 100); do
+	[ -e "$reused/Android.mk" ] && break
+	sleep 0.1
+done
+kill $!
+wait $! 2>/dev/null
+cat "$reused/errors" "$reused/Android.mk"
+rm -rf "$reused"
+
+# a bad edit to a subdirectory's arguments, once fixed, regenerates all
+# of what it did before
+edited=$(mktemp -d)
+mkdir "$edited/sub"
+printf '%s\n' -:PROJECT edited -:PROFILING_VARIANT -:AGGREGATE args \
+	-:SUBDIR sub > "$edited/args"
+printf '%s\n' -:PROJECT sub -:SHARED libsub -:SOURCES sub.c \
+	> "$edited/sub/args"
+(cd "$edited" && exec "$@" "$OLDPWD/androgenizer" --watch args Android.mk \
+	2> "$edited/errors") &
+for i in $(seq 100); do
+	[ -e "$edited/Android.mk" ] && break
+	sleep 0.1
+done
+sleep 0.5
+printf '%s\n' -:PROJECT sub -:SHARED libsub -:SOURCES sub.c -:PGO use \
+	> "$edited/sub/args"
+for i in $(seq 100); do
+	grep -q Error "$edited/errors" && break
+	sleep 0.1
+done
+printf '%s\n' -:PROJECT sub -:SHARED libsub -:SOURCES sub.c \
+	-:CFLAGS -DFIXED > "$edited/sub/args"
+for i in $(seq 100); do
+	grep -q FIXED "$edited/Android.mk" && break
+	sleep 0.1
+done
+kill $!
+wait $! 2>/dev/null
+cat "$edited/errors" "$edited/Android.mk"
+rm -rf "$edited"
+
+# -I paths of an aggregated subdirectory are relative to it
+aggregated=$(mktemp -d)
+mkdir -p "$aggregated/sub/inc"
+printf '%s\n' -:PROJECT aggregated -:PRUNE_INCLUDES -:SHARED libsub \
+	-:SOURCES a.c -:CFLAGS -Iinc -I. -Imissing > "$aggregated/sub/args"
+(cd "$aggregated" && "$@" "$OLDPWD/androgenizer" \
+	-:PROJECT aggregated \
+	-:AGGREGATE args \
+	-:SUBDIR sub)
+rm -rf "$aggregated"
+
+ANDROID_BUILD_TOP= "$@" ./androgenizer \
+	-:PROJECT generated \
+	-:SHARED libgenerated \
+	-:SOURCES main.c \
+	-:GENERATED enums.h enums.h.in \
+	-:GENERATOR sed s/@X@/1/ '$<' '>' '$@' \
+	-:GENERATED enums.c enums.c.in \
+	-:GENERATOR sed s/@X@/1/ '$<' '>' '$@'
+
+"$@" ./androgenizer \
+	-:PROJECT generated \
+	-:SHARED libgenerated \
+	-:GENERATED enums.h enums.h.in \
+	-:GENERATED enums.h other.h.in \
+	-:GENERATOR cat '$<' '>' '$@' 2>&1
+
+ANDROID_BUILD_TOP= "$@" ./androgenizer \
+	-:PROJECT startup \
+	-:SHARED libstartup \
+	-:SOURCES startup.c \
+	-:LINK_STARTUP \
+	-:SHARED libpacked \
+	-:SOURCES packed.c \
+	-:LINK_STARTUP now pack
+
+"$@" ./androgenizer \
+	-:PROJECT startup \
+	-:SHARED libstartup \
+	-:SOURCES startup.c \
+	-:LINK_STARTUP lazy \
+	-:HOST_SHARED libstartup \
+	-:SOURCES startup.c \
+	-:LINK_STARTUP lazy
+
+"$@" ./androgenizer \
+	-:PROJECT linked \
+	-:AUTO_LINK \
+	-:PROFILE release \
+	-:SHARED libhelper \
+	-:SOURCES helper.c \
+	-:LDFLAGS -lm \
+	-:AUTO_LINK \
+	-:SHARED libplugin \
+	-:SOURCES plugin.c \
+	-:SHARED liblinked \
+	-:SOURCES linked.c \
+	-:LDFLAGS -lhelper -lplugin
+
+"$@" ./androgenizer \
+	-:PROJECT pgo \
+	-:SHARED libgenerate \
+	-:SOURCES generate.c \
+	-:PGO generate \
+	-:SHARED libuse \
+	-:SOURCES use.c \
+	-:PGO use ./pgo/default.profdata generate _pgo
+
+"$@" ./androgenizer \
+	-:PROJECT pgo \
+	-:SHARED libuse \
+	-:SOURCES use.c \
+	-:PGO use \
+	-:SHARED libother 2>&1
+
+scanned=$(mktemp -d)
+mkdir -p "$scanned/sub/used" "$scanned/sub/nested" "$scanned/sub/empty"
+printf '#include "used.h"\n#include <stdio.h>\n' > "$scanned/sub/a.c"
+printf '#include "nested.h"\n' > "$scanned/sub/used/used.h"
+printf '\n' > "$scanned/sub/nested/nested.h"
+printf '#include CONFIG_H\n' > "$scanned/sub/computed.c"
+mkdir -p "$scanned/sub/cfg" "$scanned/sub/inc"
+printf '#include "dep.h"\n' > "$scanned/sub/cfg/config.h"
+printf '\n' > "$scanned/sub/inc/dep.h"
+printf '%s\n' -:PROJECT scanned -:SCAN_INCLUDES drop \
+	-:SHARED libscanned -:SOURCES a.c -:CFLAGS -Iempty -Inested -Iused \
+	-:SHARED libcomputed -:SOURCES computed.c -:CFLAGS -Iempty -Iused \
+	-:SHARED libforced -:SOURCES forced.c \
+	-:CFLAGS -include cfg/config.h -Iempty -Iinc \
+	-:SHARED libunforced -:SOURCES forced.c \
+	-:CFLAGS -include cfg/missing.h -Iempty -Iinc \
+	> "$scanned/sub/args"
+printf '\n' > "$scanned/sub/forced.c"
+(cd "$scanned" && "$@" "$OLDPWD/androgenizer" \
+	-:PROJECT scanned \
+	-:AGGREGATE args \
+	-:SUBDIR sub)
+rm -rf "$scanned"
+
+ANDROID_BUILD_TOP= "$@" ./androgenizer \
+	-:PROJECT unity \
+	-:SHARED libunity \
+	-:UNITY 2 \
+	-:UNITY_EXCLUDE clash.c \
+	-:SOURCES a.c b.c src/c.c clash.c d.cpp e.cpp
+
+"$@" ./androgenizer \
+	-:PROJECT unity \
+	-:SHARED libunity \
+	-:UNITY 4 \
+	-:SOURCES a.c src/b.c
+
+dir=$(mktemp -d)
+"$@" ./androgenizer --both "$dir/ndk.mk" "$dir/system.mk" \
+	-:PROJECT both -:SHARED libboth -:SOURCES both.c
+cat "$dir/ndk.mk" "$dir/system.mk"
+"$@" ./androgenizer --both "$dir/ndk-bad.mk" "$dir/system-bad.mk" \
+	-:PROJECT both -:SHARED libboth -:PGO use 2>&1
+ls "$dir"
+rm -rf "$dir"
+
+ANDROID_BUILD_TOP= "$@" ./androgenizer \
+	-:PROJECT stripped \
+	-:PROFILE release \
+	-:PROFILING_VARIANT \
+	-:SHARED libstripped \
+	-:SOURCES stripped.c \
+	-:EXECUTABLE debugged \
+	-:PROFILE debug \
+	-:SOURCES debugged.c
+
+"$@" ./androgenizer \
+	-:PROJECT vfpv4 \
+	-:SHARED libvfpv4 \
+	-:SOURCES vfpv4.c \
+	-:SOURCES_arm fma.c -:CFLAGS_arm -mfpu=neon-vfpv4
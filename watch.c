@@ -0,0 +1,269 @@
+/*
+    Copyright (C) 2011 Collabora Ltd. <http://www.collabora.com/>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <errno.h>
+#include <libgen.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "androgenizer.h"
+#include "watch.h"
+
+/* how long to wait for an editor or make to finish writing */
+#define SETTLE_MS 50
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | \
+		      IN_MOVED_FROM)
+
+struct invocation {
+	const char *args;
+	const char *output;
+	struct androgenizer *a;
+	int dirty;
+};
+
+struct watched_dir {
+	int wd;
+	char *path;
+};
+
+struct watcher {
+	int fd;
+	struct watched_dir *dir;
+	int dirs;
+	struct invocation *inv;
+	int invs;
+};
+
+static char *read_file(const char *path, size_t *len)
+{
+	FILE *f;
+	char *buf = NULL;
+	size_t size = 0, n;
+
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	*len = 0;
+	do {
+		size = size ? size * 2 : 4096;
+		buf = realloc(buf, size);
+		n = fread(buf + *len, 1, size - *len, f);
+		*len += n;
+	} while (*len == size);
+	fclose(f);
+	return buf;
+}
+
+/* only touch the file if it changes, or make would rebuild for nothing */
+static int write_if_changed(const char *path, const char *buf, size_t len)
+{
+	FILE *f;
+	char *old, *tmp;
+	size_t old_len;
+	int same;
+
+	old = read_file(path, &old_len);
+	same = old && old_len == len && memcmp(old, buf, len) == 0;
+	free(old);
+	if (same)
+		return 0;
+
+	/* a rename, so nothing ever sees half an Android.mk */
+	tmp = malloc(strlen(path) + 5);
+	sprintf(tmp, "%s.tmp", path);
+	f = fopen(tmp, "w");
+	if (!f || fwrite(buf, 1, len, f) != len || fclose(f) != 0 ||
+	    rename(tmp, path) != 0) {
+		fprintf(stderr, "androgenizer: Warning: Can't write '%s': %s\n",
+			path, strerror(errno));
+		unlink(tmp);
+		free(tmp);
+		return -1;
+	}
+	free(tmp);
+	return 1;
+}
+
+static void watch_dir(struct watcher *w, const char *file)
+{
+	char *copy, *dir;
+	int i, wd;
+
+	copy = strdup(file);
+	dir = dirname(copy);
+
+	wd = inotify_add_watch(w->fd, dir, WATCH_EVENTS);
+	if (wd < 0) {
+		fprintf(stderr, "androgenizer: Warning: Can't watch '%s': %s\n",
+			dir, strerror(errno));
+		free(copy);
+		return;
+	}
+
+	for (i = 0; i < w->dirs; i++)
+		if (w->dir[i].wd == wd)
+			break;
+	if (i == w->dirs) {
+		w->dirs++;
+		w->dir = realloc(w->dir, w->dirs * sizeof(struct watched_dir));
+		w->dir[i].wd = wd;
+		w->dir[i].path = strdup(dir);
+	}
+	free(copy);
+}
+
+static void regenerate(struct watcher *w, struct invocation *inv)
+{
+	const char *const *inputs;
+	const char *buf;
+	size_t len;
+	int i, n;
+
+	inv->dirty = 0;
+
+	switch (androgenizer_parse_file(inv->a, inv->args)) {
+	case ANDROGENIZER_ERROR_ARGS:
+		fprintf(stderr, "androgenizer: %s: Error in arguments: %s\n",
+			inv->args, androgenizer_error(inv->a));
+		break;
+	case ANDROGENIZER_OK:
+		if (androgenizer_emit(inv->a, &buf, &len) != ANDROGENIZER_OK)
+			break;
+		if (write_if_changed(inv->output, buf, len) > 0)
+			fprintf(stderr, "androgenizer: Updated '%s'\n",
+				inv->output);
+		break;
+	}
+
+	/* -:AGGREGATE may have picked up new subdirectories */
+	n = androgenizer_inputs(inv->a, &inputs);
+	for (i = 0; i < n; i++)
+		watch_dir(w, inputs[i]);
+}
+
+static int same_path(const char *dir, const char *name, const char *path)
+{
+	int len = strlen(dir);
+
+	if (strcmp(dir, ".") == 0 && strcmp(name, path) == 0)
+		return 1;
+
+	return strncmp(dir, path, len) == 0 && path[len] == '/' &&
+	       strcmp(path + len + 1, name) == 0;
+}
+
+static void mark_dirty(struct watcher *w, struct inotify_event *ev)
+{
+	const char *const *inputs;
+	const char *dir = NULL;
+	int i, j, n;
+
+	for (i = 0; i < w->dirs; i++)
+		if (w->dir[i].wd == ev->wd)
+			dir = w->dir[i].path;
+	if (!dir || !ev->len)
+		return;
+
+	for (i = 0; i < w->invs; i++) {
+		n = androgenizer_inputs(w->inv[i].a, &inputs);
+		for (j = 0; j < n; j++)
+			if (same_path(dir, ev->name, inputs[j]))
+				w->inv[i].dirty = 1;
+	}
+}
+
+/*
+ * returns 0 once nothing more arrived within timeout, or -1 if the
+ * inotify descriptor can't be waited on or read any more
+ */
+static int read_events(struct watcher *w, int timeout)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfd = { .fd = w->fd, .events = POLLIN };
+	struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+	int ready;
+
+	ready = poll(&pfd, 1, timeout);
+	if (ready < 0)
+		return errno == EINTR ? 0 : -1;
+	if (!ready)
+		return 0;
+
+	len = read(w->fd, buf, sizeof(buf));
+	if (len < 0)
+		return errno == EINTR ? 1 : -1;
+	if (!len)
+		return 0;
+
+	for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+		ev = (struct inotify_event *)p;
+		mark_dirty(w, ev);
+	}
+	return 1;
+}
+
+int watch(int argc, char **argv)
+{
+	struct watcher w = { 0 };
+	int i, ret;
+
+	if (argc < 2 || argc % 2) {
+		fprintf(stderr, "Usage: androgenizer --watch <arguments file> <Android.mk> ...\n");
+		return 1;
+	}
+
+	w.fd = inotify_init1(IN_CLOEXEC);
+	if (w.fd < 0) {
+		perror("androgenizer: inotify_init1");
+		return 1;
+	}
+
+	w.invs = argc / 2;
+	w.inv = calloc(w.invs, sizeof(struct invocation));
+	for (i = 0; i < w.invs; i++) {
+		w.inv[i].args = argv[2 * i];
+		w.inv[i].output = argv[2 * i + 1];
+		w.inv[i].a = androgenizer_new();
+		regenerate(&w, &w.inv[i]);
+	}
+
+	for (;;) {
+		/* wait for a change, then let the burst of writes settle */
+		ret = read_events(&w, -1);
+		if (!ret)
+			continue;
+		while (ret > 0)
+			ret = read_events(&w, SETTLE_MS);
+		if (ret < 0) {
+			perror("androgenizer: Can't watch for changes");
+			return 1;
+		}
+
+		for (i = 0; i < w.invs; i++)
+			if (w.inv[i].dirty)
+				regenerate(&w, &w.inv[i]);
+	}
+
+	return 0;
+}